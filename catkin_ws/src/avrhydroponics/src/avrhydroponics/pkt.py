@@ -30,7 +30,30 @@ logger.addHandler(ch)
  PACKET_ID_RESPONSE_LIGHT_WHITE_GET, PACKET_ID_CMD_FAN_SET_SPEED,
  PACKET_ID_CMD_FAN_GET_SPEED, PACKET_ID_RESPONSE_FAN_GET_SPEED,
  PACKET_ID_READY_REQUEST, PACKET_ID_RESPONSE_READY_REQUEST,
- PACKET_ID_ACK) = range(48)
+ PACKET_ID_ACK, PACKET_ID_CMD_OWI_SET_SAMPLING, PACKET_ID_CMD_OWI_SET_ALARM,
+ PACKET_ID_CMD_OWI_MEASURE_ALARMS,
+ PACKET_ID_RESPONSE_OWI_MEASURE_ALARMS, PACKET_ID_CMD_OWI_SET_READ_MODE,
+ PACKET_ID_CMD_OWI_GET_STATS, PACKET_ID_RESPONSE_OWI_GET_STATS,
+ PACKET_ID_CMD_OWI_SET_PROFILE, PACKET_ID_CMD_FAN_SET_SPEEDS,
+ PACKET_ID_CMD_PWM_RAMP, PACKET_ID_CMD_FAN_CONTROL_SET_LEVELS,
+ PACKET_ID_CMD_FAN_CONTROL_SET_SENSORS, PACKET_ID_CMD_FAN_CONTROL_ENABLE,
+ PACKET_ID_CMD_FAN_CONTROL_GET_STATE,
+ PACKET_ID_RESPONSE_FAN_CONTROL_GET_STATE, PACKET_ID_CMD_WATER_MEASURE,
+ PACKET_ID_DATA_WATER, PACKET_ID_CMD_WATER_SET_SENSORS,
+ PACKET_ID_CMD_PROBE_SET_DEVICE) = range(67)
+
+OWI_READ_VERIFIED = 0
+OWI_READ_FAST = 1
+
+PWM_CURVE_LINEAR = 0
+PWM_CURVE_EASE_IN_OUT = 1
+PWM_CURVE_QUADRATIC = 2
+
+CALIB_CHUNK_SIZE = 64
+
+PROBE_TYPE_NONE = 0
+PROBE_TYPE_EC = 1
+PROBE_TYPE_PH = 2
 
 crc_fun = crcmod.predefined.mkCrcFun("xmodem")
 
@@ -122,60 +145,149 @@ def encode_cmd_owi_measure():
 def decode_data_owi(packet):
     rom = packet.payload[0:8]
     temperature = float(packet.payload[8] | (packet.payload[9] << 8)) / 16.0
-    return dict(rom=rom, temperature=temperature)
+    age = int(packet.payload[10] | (packet.payload[11] << 8))
+    return dict(rom=rom, temperature=temperature, age=age)
 
 
 def decode_response_owi_get_res(packet):
     return int(packet.payload[0])
 
 
-def encode_cmd_ec_measure():
+def encode_cmd_owi_set_sampling(period_ms, max_age_ms):
     packet = Packet()
-    packet.id = PACKET_ID_CMD_EC_MEASURE
+    packet.id = PACKET_ID_CMD_OWI_SET_SAMPLING
+    for value in (period_ms, max_age_ms):
+        packet.payload.append(value & 0xFF)
+        packet.payload.append((value >> 8) & 0xFF)
+        packet.payload.append((value >> 16) & 0xFF)
+        packet.payload.append((value >> 24) & 0xFF)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_owi_set_alarm(rom, high, low):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_OWI_SET_ALARM
+    packet.payload.extend(rom)
+    packet.payload.append(high & 0xFF)
+    packet.payload.append(low & 0xFF)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ec_import_calib(calib_data):
+def encode_cmd_owi_measure_alarms():
     packet = Packet()
-    packet.id = PACKET_ID_CMD_EC_IMPORT_CALIB
-    packet.payload = bytearray(calib_data)
+    packet.id = PACKET_ID_CMD_OWI_MEASURE_ALARMS
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ec_export_calib():
+def decode_response_owi_measure_alarms(packet):
+    return int(packet.payload[0])
+
+
+def encode_cmd_owi_set_read_mode(mode):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_OWI_SET_READ_MODE
+    packet.payload.append(mode)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_owi_get_stats():
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_OWI_GET_STATS
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_owi_set_profile(rom, res, adaptive):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_OWI_SET_PROFILE
+    packet.payload.extend(rom)
+    packet.payload.append(res)
+    packet.payload.append(1 if adaptive else 0)
+    packet.update_lengths()
+    return packet
+
+
+def decode_response_owi_get_stats(packet):
+    mode = int(packet.payload[0])
+    reads, crc_errors, retries = (
+        int(packet.payload[i] | (packet.payload[i + 1] << 8))
+        for i in (1, 3, 5))
+    return dict(mode=mode, reads=reads, crc_errors=crc_errors,
+                retries=retries)
+
+
+def encode_cmd_ec_measure(device=0):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_EC_MEASURE
+    packet.payload.append(device)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_ec_import_calib(device=0, calib_data=b""):
+    # no data imports the calibration cached on the controller
+    chunks = [calib_data[i:i + CALIB_CHUNK_SIZE]
+              for i in range(0, len(calib_data), CALIB_CHUNK_SIZE)]
+    packets = []
+    for index, chunk in enumerate(chunks):
+        packet = Packet()
+        packet.id = PACKET_ID_CMD_EC_IMPORT_CALIB
+        packet.payload.append(device)
+        packet.payload.append(index)
+        packet.payload.append(len(chunks))
+        packet.payload.extend(bytearray(chunk))
+        packet.update_lengths()
+        packets.append(packet)
+    if not packets:
+        packet = Packet()
+        packet.id = PACKET_ID_CMD_EC_IMPORT_CALIB
+        packet.payload.append(device)
+        packet.update_lengths()
+        packets.append(packet)
+    return packets
+
+
+def encode_cmd_ec_export_calib(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_EC_EXPORT_CALIB
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ec_calib_dry():
+def encode_cmd_ec_calib_dry(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_EC_CALIB_DRY
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ec_calib_low():
+def encode_cmd_ec_calib_low(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_EC_CALIB_LOW
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ec_calib_high():
+def encode_cmd_ec_calib_high(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_EC_CALIB_HIGH
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ec_compensation(temperature):
-    value = int(temperature * 100)
+def encode_cmd_ec_compensation(temperature, device=0):
+    value = int(round(temperature * 100))
     packet = Packet()
     packet.id = PACKET_ID_CMD_EC_COMPENSATION
+    packet.payload.append(device)
     packet.payload.append(value & 0xFF)
     packet.payload.append((value >> 8) & 0xFF)
     packet.payload.append((value >> 16) & 0xFF)
@@ -185,9 +297,61 @@ def encode_cmd_ec_compensation(temperature):
 
 
 def decode_data_ec(packet):
-    ec = int(packet.payload[0] | (packet.payload[1] << 8)
-             | (packet.payload[2] << 16) | (packet.payload[3] << 24))
-    return ec
+    ec = int(packet.payload[1] | (packet.payload[2] << 8)
+             | (packet.payload[3] << 16) | (packet.payload[4] << 24))
+    return dict(device=int(packet.payload[0]), ec=ec)
+
+
+def encode_cmd_water_measure():
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_WATER_MEASURE
+    packet.update_lengths()
+    return packet
+
+
+def decode_data_water(packet):
+    # a value is None if its device could not be read
+    count = int(packet.payload[0])
+    valid = int(packet.payload[1])
+    readings = []
+    for device in range(count):
+        i = 2 + 5 * device
+        probe_type = int(packet.payload[i])
+        value = int(packet.payload[i + 1] | (packet.payload[i + 2] << 8)
+                    | (packet.payload[i + 3] << 16)
+                    | (packet.payload[i + 4] << 24))
+        if not valid & (1 << device):
+            value = None
+        elif probe_type == PROBE_TYPE_PH:
+            value = value / 1000.0
+        readings.append(dict(device=device, type=probe_type, value=value))
+    return readings
+
+
+def encode_cmd_water_set_sensors(device, roms):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_WATER_SET_SENSORS
+    packet.payload.append(device)
+    packet.payload.append(len(roms))
+    for rom in roms:
+        packet.payload.extend(rom)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_probe_set_device(device, probe_type, address, uart_id=0,
+                                enable_port="", enable_pin=0):
+    # takes effect after the next reset of the controller
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_PROBE_SET_DEVICE
+    packet.payload.append(device)
+    packet.payload.append(probe_type)
+    packet.payload.append(address)
+    packet.payload.append(uart_id)
+    packet.payload.append(ord(enable_port) if enable_port else 0)
+    packet.payload.append(enable_pin)
+    packet.update_lengths()
+    return packet
 
 
 def decode_response_ec_get_calib_format(packet):
@@ -197,12 +361,16 @@ def decode_response_ec_get_calib_format(packet):
 
 
 def decode_response_ec_export_calib(packet):
-    return packet.payload
+    return dict(device=int(packet.payload[0]),
+                chunk=int(packet.payload[1]),
+                n_chunks=int(packet.payload[2]),
+                data=bytearray(packet.payload[3:]))
 
 
-def encode_cmd_ph_measure():
+def encode_cmd_ph_measure(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_PH_MEASURE
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
@@ -214,46 +382,66 @@ def encode_cmd_ph_get_calib_format():
     return packet
 
 
-def encode_cmd_ph_import_calib(calib_data):
-    packet = Packet()
-    packet.id = PACKET_ID_CMD_PH_GET_CALIB_FORMAT
-    packet.payload = bytearray(calib_data)
-    packet.update_lengths()
-    return packet
+def encode_cmd_ph_import_calib(device=0, calib_data=b""):
+    # no data imports the calibration cached on the controller
+    chunks = [calib_data[i:i + CALIB_CHUNK_SIZE]
+              for i in range(0, len(calib_data), CALIB_CHUNK_SIZE)]
+    packets = []
+    for index, chunk in enumerate(chunks):
+        packet = Packet()
+        packet.id = PACKET_ID_CMD_PH_IMPORT_CALIB
+        packet.payload.append(device)
+        packet.payload.append(index)
+        packet.payload.append(len(chunks))
+        packet.payload.extend(bytearray(chunk))
+        packet.update_lengths()
+        packets.append(packet)
+    if not packets:
+        packet = Packet()
+        packet.id = PACKET_ID_CMD_PH_IMPORT_CALIB
+        packet.payload.append(device)
+        packet.update_lengths()
+        packets.append(packet)
+    return packets
 
 
-def encode_cmd_ph_export_calib():
+def encode_cmd_ph_export_calib(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_PH_EXPORT_CALIB
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ph_calib_low():
+def encode_cmd_ph_calib_low(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_PH_CALIB_LOW
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ph_calib_mid():
+def encode_cmd_ph_calib_mid(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_PH_CALIB_MID
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ph_calib_high():
+def encode_cmd_ph_calib_high(device=0):
     packet = Packet()
     packet.id = PACKET_ID_CMD_PH_CALIB_HIGH
+    packet.payload.append(device)
     packet.update_lengths()
     return packet
 
 
-def encode_cmd_ph_compensation(temperature):
-    value = int(temperature * 100)
+def encode_cmd_ph_compensation(temperature, device=0):
+    value = int(round(temperature * 100))
     packet = Packet()
     packet.id = PACKET_ID_CMD_PH_COMPENSATION
+    packet.payload.append(device)
     packet.payload.append(value & 0xFF)
     packet.payload.append((value >> 8) & 0xFF)
     packet.payload.append((value >> 16) & 0xFF)
@@ -263,10 +451,10 @@ def encode_cmd_ph_compensation(temperature):
 
 
 def decode_data_ph(packet):
-    ph = float(packet.payload[0] | (packet.payload[1] << 8)
-               | (packet.payload[2] << 16)
-               | (packet.payload[3] << 24)) / 1000.0
-    return ph
+    ph = float(packet.payload[1] | (packet.payload[2] << 8)
+               | (packet.payload[3] << 16)
+               | (packet.payload[4] << 24)) / 1000.0
+    return dict(device=int(packet.payload[0]), ph=ph)
 
 
 def decode_response_ph_get_calib_format(packet):
@@ -276,7 +464,10 @@ def decode_response_ph_get_calib_format(packet):
 
 
 def decode_response_ph_export_calib(packet):
-    return packet.payload
+    return dict(device=int(packet.payload[0]),
+                chunk=int(packet.payload[1]),
+                n_chunks=int(packet.payload[2]),
+                data=bytearray(packet.payload[3:]))
 
 
 def encode_cmd_light_set(state):
@@ -365,6 +556,90 @@ def encode_cmd_fan_set_speed(index, speed):
     return packet
 
 
+def encode_cmd_fan_set_speeds(speeds):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_FAN_SET_SPEEDS
+    packet.payload.append(len(speeds))
+    for index, speed in sorted(speeds.items()):
+        packet.payload.append(index)
+        packet.payload.append(speed & 0xFF)
+        packet.payload.append((speed >> 8) & 0xFF)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_pwm_ramp(index, target, duration_ms, curve=PWM_CURVE_LINEAR):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_PWM_RAMP
+    packet.payload.append(index)
+    packet.payload.append(target & 0xFF)
+    packet.payload.append((target >> 8) & 0xFF)
+    for i in range(4):
+        packet.payload.append((duration_ms >> (8 * i)) & 0xFF)
+    packet.payload.append(curve)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_fan_control_set_levels(levels):
+    # levels: list of dicts with low and high in degree Celsius and the raw
+    # pwm value, e.g. led_temp_lvls of pwm.yaml scaled by pwm_max_value
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_FAN_CONTROL_SET_LEVELS
+    packet.payload.append(len(levels))
+    for level in levels:
+        for value in (int(round(level["low"] * 16)),
+                      int(round(level["high"] * 16)), int(level["pwm"])):
+            value = max(-0x8000, min(0xFFFF, value)) & 0xFFFF
+            packet.payload.append(value & 0xFF)
+            packet.payload.append((value >> 8) & 0xFF)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_fan_control_set_sensors(roms):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_FAN_CONTROL_SET_SENSORS
+    packet.payload.append(len(roms))
+    for rom in roms:
+        packet.payload.extend(rom)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_fan_control_enable(enabled, channels):
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_FAN_CONTROL_ENABLE
+    packet.payload.append(1 if enabled else 0)
+    mask = 0
+    for channel in channels:
+        mask |= 1 << channel
+    packet.payload.append(mask & 0xFF)
+    packet.payload.append((mask >> 8) & 0xFF)
+    packet.update_lengths()
+    return packet
+
+
+def encode_cmd_fan_control_get_state():
+    packet = Packet()
+    packet.id = PACKET_ID_CMD_FAN_CONTROL_GET_STATE
+    packet.update_lengths()
+    return packet
+
+
+def decode_response_fan_control_get_state(packet):
+    enabled = bool(packet.payload[0])
+    level = int(packet.payload[1])
+    temperature = int(packet.payload[2] | (packet.payload[3] << 8))
+    if temperature >= 0x8000:
+        temperature -= 0x10000
+    pwm = int(packet.payload[4] | (packet.payload[5] << 8))
+    return dict(enabled=enabled,
+                level=None if level == 255 else level,
+                temperature=temperature / 16.0,
+                pwm=pwm)
+
+
 def decode_cmd_fan_get_speed(index):
     packet = Packet()
     packet.id = PACKET_ID_CMD_FAN_GET_SPEED
@@ -0,0 +1,19 @@
+#ifndef COMPENSATION_H_
+#define COMPENSATION_H_
+
+#include "common.h"
+
+#define COMPENSATION_MAX_SENSORS 4
+
+/**
+ * @brief Water temperatures older than this are not used for compensation.
+ */
+#define COMPENSATION_MAX_AGE_MS 60000UL
+
+void compensation_init();
+return_status_t compensation_set_sensors(uint8_t index,
+                                         const uint8_t (*new_roms)[8],
+                                         uint8_t count);
+uint8_t compensation_get(uint8_t index, int16_t *centi_degrees);
+
+#endif /* COMPENSATION_H_ */
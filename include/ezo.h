@@ -0,0 +1,139 @@
+#ifndef EZO_H_
+#define EZO_H_
+
+#include "common.h"
+#include "scheduler.h"
+#include "serial.h"
+#include "twi.h"
+
+#define EZO_MAX_COMMAND_LENGTH 32
+#define EZO_MAX_RESPONSE_LENGTH 40
+#define EZO_QUEUE_LENGTH 4
+
+/**
+ * @brief Processing times of the EZO circuits after which the response is
+ * read for the first time.
+ */
+#define EZO_WAIT_READ_MS 900
+#define EZO_WAIT_GENERAL_MS 300
+/**
+ * @brief Interval in which a response is polled again while the circuit is
+ * still processing, and the number of these polls before giving up.
+ */
+#define EZO_POLL_INTERVAL_MS 50
+#define EZO_MAX_POLLS 20
+
+/**
+ * @brief Size of the calibration of a circuit and of the chunks it is
+ * transferred to and from the host in.
+ */
+#define EZO_CALIBRATION_SIZE 160
+#define EZO_CALIBRATION_CHUNK_SIZE 64
+
+/**
+ * @brief Baud rate of circuits in UART mode.
+ */
+#define EZO_UART_BAUD 9600
+/**
+ * @brief Continuous readings older than this are not handed out any more.
+ */
+#define EZO_UART_MAX_AGE_MS 5000
+
+typedef struct ezo_s ezo_t;
+
+/**
+ * @brief Called from the task of the circuit when a command is done.
+ *
+ * @param data The response without its code. Only valid during the call.
+ */
+typedef void (*ezo_callback_t)(ezo_t *ezo, return_status_t status, char *data,
+                               void *context);
+typedef void (*ezo_calibration_callback_t)(ezo_t *ezo,
+                                           return_status_t status);
+
+/**
+ * @brief Calibration of a circuit as kept in EEPROM by the owner of the
+ * circuit.
+ *
+ * #data holds the `Export` strings of the circuit one after another, each
+ * terminated by a zero, so they can be imported again one by one. Only valid
+ * if #magic is set.
+ */
+typedef struct {
+    uint8_t magic;
+    uint8_t length;
+    uint8_t data[EZO_CALIBRATION_SIZE];
+} ezo_calibration_t;
+
+typedef struct {
+    char command[EZO_MAX_COMMAND_LENGTH];
+    uint16_t wait_ms;
+    ezo_callback_t callback;
+    void *context;
+} ezo_command_t;
+
+typedef enum {
+    EZO_IDLE,
+    EZO_WRITING,
+    EZO_WAITING,
+    EZO_READING
+} ezo_state_t;
+
+/**
+ * @brief An Atlas Scientific EZO circuit on the I2C bus or on a USART.
+ *
+ * Commands are queued and processed one after another by a task of the
+ * circuit. Circuits at different addresses process their commands at the
+ * same time.
+ *
+ * A circuit in UART mode streams its readings continuously. The receive
+ * interrupt splits the stream into lines and keeps the latest reading in
+ * #reading, so an `R` command is answered from there without any bus
+ * traffic.
+ */
+struct ezo_s {
+    uint8_t address;
+    serial_log_source_t source;  ///< Source of the log messages.
+    ezo_state_t state;
+    ezo_command_t queue[EZO_QUEUE_LENGTH];
+    uint8_t head;
+    uint8_t count;
+    uint8_t polls;
+    twi_transaction_t transaction;
+    char response[EZO_MAX_RESPONSE_LENGTH + 1];
+    task_t task;
+    ezo_calibration_t *calibration;  ///< EEPROM copy being transferred.
+    ezo_calibration_callback_t calibration_callback;
+    uint8_t calibration_offset;
+    uint8_t import_chunk;  ///< Next chunk expected from the host.
+    uint8_t uart_id;  ///< USART of a circuit in UART mode, 0 in I2C mode.
+    uint8_t continuous;
+    uint32_t command_ms;  ///< Time the command in progress was written.
+    char rx[EZO_MAX_RESPONSE_LENGTH + 1];
+    uint8_t rx_length;
+    char reading[EZO_MAX_RESPONSE_LENGTH + 1];
+    volatile uint32_t reading_ms;
+    volatile uint8_t reading_valid;
+    volatile uint8_t response_code;
+};
+
+void ezo_init(ezo_t *ezo, uint8_t address, serial_log_source_t source);
+void ezo_init_uart(ezo_t *ezo, uint8_t uart_id, serial_log_source_t source);
+return_status_t ezo_submit(ezo_t *ezo, const char *command, uint16_t wait_ms,
+                           ezo_callback_t callback, void *context);
+uint8_t ezo_busy(const ezo_t *ezo);
+void ezo_log_done(ezo_t *ezo, return_status_t status, char *data,
+                  void *context);
+return_status_t ezo_read_compensated(ezo_t *ezo, int16_t centi_degrees,
+                                     ezo_callback_t callback, void *context);
+return_status_t ezo_export_calibration(ezo_t *ezo, ezo_calibration_t *cache,
+                                       ezo_calibration_callback_t callback);
+return_status_t ezo_import_calibration(ezo_t *ezo, ezo_calibration_t *cache,
+                                       ezo_calibration_callback_t callback);
+return_status_t ezo_import_calibration_chunk(
+    ezo_t *ezo, ezo_calibration_t *cache, uint8_t chunk, uint8_t n_chunks,
+    const uint8_t *data, uint8_t length, ezo_calibration_callback_t callback);
+uint8_t ezo_calibration_chunk(const ezo_calibration_t *cache, uint8_t chunk,
+                              uint8_t *data, uint8_t *n_chunks);
+
+#endif /* EZO_H_ */
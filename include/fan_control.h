@@ -0,0 +1,42 @@
+#ifndef FAN_CONTROL_H_
+#define FAN_CONTROL_H_
+
+#include "common.h"
+
+#define FAN_CONTROL_MAX_LEVELS 8
+#define FAN_CONTROL_MAX_SENSORS 8
+
+/**
+ * @brief Time the fans take to change to the speed of a new level.
+ */
+#define FAN_CONTROL_RAMP_MS 2000
+/**
+ * @brief Readings older than this are not considered. Without any recent
+ * reading the fans run at the speed of the highest level.
+ */
+#define FAN_CONTROL_MAX_AGE_MS 60000UL
+
+/**
+ * @brief One level of the hysteresis table.
+ *
+ * The temperatures are given in DS18B20 units of 1/16 degree Celsius. The
+ * level is left upwards once the hottest LED sensor exceeds #high and
+ * downwards once it falls below #low. Neighbouring bands overlap to form the
+ * hysteresis.
+ */
+typedef struct {
+    int16_t low;
+    int16_t high;
+    uint16_t pwm;
+} fan_control_level_t;
+
+void fan_control_init();
+return_status_t fan_control_set_levels(const fan_control_level_t *new_levels,
+                                       uint8_t count);
+return_status_t fan_control_set_sensors(const uint8_t (*new_roms)[8],
+                                        uint8_t count);
+void fan_control_enable(uint8_t enable, uint16_t fan_channels);
+void fan_control_get_state(uint8_t *is_enabled, uint8_t *current_level,
+                           int16_t *temperature, uint16_t *pwm);
+
+#endif /* FAN_CONTROL_H_ */
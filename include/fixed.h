@@ -0,0 +1,16 @@
+#ifndef FIXED_H_
+#define FIXED_H_
+
+#include "common.h"
+
+/**
+ * @brief Longest string written by @ref fixed_format(), including the
+ * terminating zero: sign, 10 digits and the decimal point.
+ */
+#define FIXED_MAX_STRING_LENGTH 13
+
+return_status_t fixed_parse(const char *string, uint8_t decimals,
+                            int32_t *value);
+uint8_t fixed_format(char *buffer, int32_t value, uint8_t decimals);
+
+#endif /* FIXED_H_ */
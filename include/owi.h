@@ -12,8 +12,19 @@
 
 #include "common.h"
 
+/**
+ * @brief Alarm limits in degree Celsius that never trigger.
+ */
+#define OWI_ALARM_HIGH_OFF 127
+#define OWI_ALARM_LOW_OFF (-128)
+
 enum owi_resolution_e { OWI_RES_12, OWI_RES_11, OWI_RES_10, OWI_RES_9 };
 
+/**
+ * @brief Number of resolutions in @ref owi_resolution_e.
+ */
+#define OWI_N_RESOLUTIONS 4
+
 typedef enum owi_resolution_e owi_resolution_t;
 
 struct ds18b20_s {
@@ -28,45 +39,189 @@ struct ds18b20_s {
 
 typedef struct ds18b20_s ds18b20_t;
 
-void owi_init(volatile uint8_t *owi_port, uint8_t owi_pinNumber);
+/**
+ * @brief How the scratchpad is read when measuring temperatures.
+ *
+ * - #OWI_READ_FAST reads the two temperature bytes only and ends the read with
+ * a reset. It takes 16 instead of 72 read slots per sensor, but transmission
+ * errors go undetected and a reading of exactly -0.0625 degree Celsius can not
+ * be told apart from a missing sensor.
+ * - #OWI_READ_VERIFIED reads the whole scratchpad, checks its CRC and retries
+ * up to #OWI_READ_RETRIES times.
+ */
+enum owi_read_mode_e { OWI_READ_VERIFIED, OWI_READ_FAST };
+
+typedef enum owi_read_mode_e owi_read_mode_t;
 
-return_status_t owi_reset();
+/**
+ * @brief Number of repeated reads after a CRC error in #OWI_READ_VERIFIED
+ * mode.
+ */
+#define OWI_READ_RETRIES 2
+
+/**
+ * @brief Counters of the scratchpad reads of a bus since startup. They wrap
+ * around on overflow.
+ */
+struct owi_stats_s {
+    uint16_t reads;
+    uint16_t crc_errors;
+    uint16_t retries;
+};
 
-void owi_write_bit(uint8_t bit);
+typedef struct owi_stats_s owi_stats_t;
 
-void owi_write_byte(uint8_t byte);
+/**
+ * @brief Maximum number of OWI lines driven in lockstep, one per pin of a port.
+ */
+#define OWI_MAX_LINES 8
 
-uint8_t owi_read_bit();
+/**
+ * @brief Port of the OWI lines.
+ *
+ * Building with `OWI_UART` defined replaces the bit-banged lines by a single
+ * line driven by USART1, see owi_uart.h.
+ *
+ * The port is a compile time constant so that the slot timing does not
+ * depend on loading a register address at runtime. Ports in the lower I/O
+ * space (PORTA to PORTG) are accessed with single cycle instructions.
+ */
+#ifndef OWI_PORT
+#define OWI_PORT PORTD
+#endif
 
-uint8_t owi_read_byte();
+/**
+ * @brief Pins of #OWI_PORT used as OWI lines. More lines can be added to split
+ * the sensors, e.g. heatsink and water sensors, without slowing down
+ * measurements.
+ */
+#ifndef OWI_PINS
+#ifdef OWI_UART
+// TXD1, RXD1 (PD2) is connected to the same line
+#define OWI_PINS (1 << PD3)
+#else
+#define OWI_PINS (1 << PD4)
+#endif
+#endif
 
-void owi_read_rom(uint8_t *romBuffer);
+/**
+ * @brief Describes one or more OWI data lines of #OWI_PINS.
+ *
+ * Resets and slots are generated on all lines in #pins at the same time, so
+ * a sequence takes as long on all lines as on a single one. The search state
+ * is only meaningful for descriptors with a single line, see @ref
+ * owi_line().
+ *
+ * A line descriptor takes over the read mode of its bus and counts its reads
+ * in #stats of the bus.
+ */
+struct owi_bus_s {
+    uint8_t pins;
+    uint8_t rom[8];
+    uint8_t last_discrepancy;
+    uint8_t last_family_discrepancy;
+    uint8_t last_device_flag;
+    uint8_t conversion_pending;
+    uint8_t conversion_pollable;
+    uint32_t conversion_start_ms;
+    uint32_t conversion_deadline;
+    uint8_t read_pending;
+    uint8_t read_failed;
+    uint8_t read_retries;
+    owi_read_mode_t read_mode;
+    owi_stats_t own_stats;
+    owi_stats_t *stats;
+};
 
-return_status_t owi_search();
+typedef struct owi_bus_s owi_bus_t;
 
-return_status_t owi_search_first();
+void owi_init(owi_bus_t *bus);
 
-return_status_t owi_search_next();
+void owi_line(const owi_bus_t *bus, uint8_t pin_number, owi_bus_t *line);
 
-return_status_t owi_get_buffered_rom(uint8_t *buffer);
+void owi_set_read_mode(owi_bus_t *bus, owi_read_mode_t mode);
 
-uint8_t owi_verify_device();
+void owi_get_stats(const owi_bus_t *bus, owi_stats_t *stats);
 
-return_status_t owi_get_devices(ds18b20_t *devices, uint8_t array_size,
-                             uint8_t *count);
+uint8_t owi_reset_lines(owi_bus_t *bus);
 
-return_status_t owi_set_resolution_all(owi_resolution_t resolution);
+return_status_t owi_reset(owi_bus_t *bus);
+
+void owi_write_bit(owi_bus_t *bus, uint8_t bit);
+
+void owi_write_byte(owi_bus_t *bus, uint8_t byte);
+
+void owi_write_bytes(owi_bus_t *bus, const uint8_t *bytes);
+
+uint8_t owi_read_bits(owi_bus_t *bus);
+
+uint8_t owi_read_bit(owi_bus_t *bus);
+
+uint8_t owi_read_byte(owi_bus_t *bus);
+
+void owi_read_bytes(owi_bus_t *bus, uint8_t *bytes);
+
+void owi_read_rom(owi_bus_t *bus, uint8_t *romBuffer);
+
+return_status_t owi_search(owi_bus_t *bus);
+
+return_status_t owi_search_first(owi_bus_t *bus);
+
+return_status_t owi_search_next(owi_bus_t *bus);
+
+return_status_t owi_alarm_search_first(owi_bus_t *bus);
+
+return_status_t owi_alarm_search_next(owi_bus_t *bus);
+
+return_status_t owi_get_buffered_rom(owi_bus_t *bus, uint8_t *buffer);
+
+uint8_t owi_verify_device(owi_bus_t *bus);
+
+uint8_t owi_verify_rom(owi_bus_t *bus, const uint8_t *device_rom);
+
+return_status_t owi_get_devices(owi_bus_t *bus, ds18b20_t *devices,
+                                uint8_t array_size, uint8_t *count);
+
+return_status_t owi_set_resolution_all(owi_bus_t *bus,
+                                       owi_resolution_t resolution);
 
 return_status_t owi_get_resolution_all(owi_resolution_t *resolution);
 
-void owi_set_resolution(ds18b20_t *device, owi_resolution_t resolution);
+return_status_t owi_recall_all(owi_bus_t *bus);
+
+return_status_t owi_set_resolution(owi_bus_t *bus, ds18b20_t *device,
+                                   owi_resolution_t resolution);
+
+return_status_t owi_write_resolution(owi_bus_t *bus, ds18b20_t *device,
+                                     owi_resolution_t resolution);
+
+return_status_t owi_read_config(owi_bus_t *bus, ds18b20_t *device);
+
+return_status_t owi_set_alarm(owi_bus_t *bus, ds18b20_t *device, int8_t high,
+                              int8_t low);
+
+return_status_t owi_read_temperature(owi_bus_t *bus, ds18b20_t *device);
+
+uint8_t owi_read_temperatures(owi_bus_t *bus, ds18b20_t **devices);
+
+void owi_read_temperatures_start(owi_bus_t *bus, ds18b20_t **devices);
+
+return_status_t owi_read_temperatures_done(owi_bus_t *bus, ds18b20_t **devices,
+                                           uint8_t *failed);
+
+return_status_t owi_read_scratchpad(owi_bus_t *bus, ds18b20_t *device,
+                                   uint8_t *buffer);
+
+uint16_t owi_conversion_time_ms(owi_resolution_t resolution);
+
+return_status_t owi_start_conversion(owi_bus_t *bus);
 
-return_status_t owi_read_temperature(ds18b20_t *device);
+return_status_t owi_start_conversion_device(owi_bus_t *bus, ds18b20_t *device);
 
-void owi_read_scratchpad(ds18b20_t *device, uint8_t *buffer);
+return_status_t owi_conversion_done(owi_bus_t *bus);
 
-return_status_t owi_start_conversion();
+return_status_t owi_wait_conversion(owi_bus_t *bus, ds18b20_t *device);
 
-return_status_t owi_wait_conversion(ds18b20_t *device);
+void owi_benchmark(owi_bus_t *bus, uint16_t *write_us, uint16_t *read_us);
 
 #endif /* AVR_LIB_OWI_H_ */
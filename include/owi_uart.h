@@ -0,0 +1,23 @@
+/**
+ * @file owi_uart.h
+ * @brief OWI master on USART1.
+ *
+ * Alternative to the bit-banged lines of owi.c, selected by building with
+ * `OWI_UART` defined. TXD1 drives the line through an open drain stage (e.g. a
+ * diode or an N-MOSFET) and RXD1 reads the line back. A reset is a 0xF0 frame
+ * at 9600 baud, every slot is a single frame at 115200 baud, so the slot
+ * timing is generated by the USART and not disturbed by other interrupts.
+ */
+#ifndef OWI_UART_H_
+#define OWI_UART_H_
+
+#include "common.h"
+
+void owi_uart_init();
+uint8_t owi_uart_reset();
+void owi_uart_start(const uint8_t *tx, uint8_t *rx, uint16_t n_slots);
+return_status_t owi_uart_done();
+return_status_t owi_uart_transfer(const uint8_t *tx, uint8_t *rx,
+                                  uint16_t n_slots);
+
+#endif /* OWI_UART_H_ */
@@ -58,7 +58,27 @@ typedef enum {
 
     PACKET_ID_READY_REQUEST,
     PACKET_ID_RESPONSE_READY_REQUEST,
-    PACKET_ID_ACK
+    PACKET_ID_ACK,
+
+    PACKET_ID_CMD_OWI_SET_SAMPLING,
+    PACKET_ID_CMD_OWI_SET_ALARM,
+    PACKET_ID_CMD_OWI_MEASURE_ALARMS,
+    PACKET_ID_RESPONSE_OWI_MEASURE_ALARMS,
+    PACKET_ID_CMD_OWI_SET_READ_MODE,
+    PACKET_ID_CMD_OWI_GET_STATS,
+    PACKET_ID_RESPONSE_OWI_GET_STATS,
+    PACKET_ID_CMD_OWI_SET_PROFILE,
+    PACKET_ID_CMD_FAN_SET_SPEEDS,
+    PACKET_ID_CMD_PWM_RAMP,
+    PACKET_ID_CMD_FAN_CONTROL_SET_LEVELS,
+    PACKET_ID_CMD_FAN_CONTROL_SET_SENSORS,
+    PACKET_ID_CMD_FAN_CONTROL_ENABLE,
+    PACKET_ID_CMD_FAN_CONTROL_GET_STATE,
+    PACKET_ID_RESPONSE_FAN_CONTROL_GET_STATE,
+    PACKET_ID_CMD_WATER_MEASURE,
+    PACKET_ID_DATA_WATER,
+    PACKET_ID_CMD_WATER_SET_SENSORS,
+    PACKET_ID_CMD_PROBE_SET_DEVICE
 }
 packet_id_t;
 
@@ -75,41 +95,105 @@ void encode_cmd_owi_set_res(packet_t *packet, uint8_t res);
 void decode_cmd_owi_set_res(packet_t *packet, uint8_t *res);
 void encode_cmd_owi_get_res(packet_t *packet);
 void encode_cmd_owi_measure(packet_t *packet);
-void encode_data_owi(packet_t *packet, uint8_t *rom, uint16_t temperature);
-void decode_data_owi(packet_t *packet, uint8_t *rom, uint16_t *temperature);
+void encode_data_owi(packet_t *packet, uint8_t *rom, uint16_t temperature,
+                     uint16_t age_ms);
+void decode_data_owi(packet_t *packet, uint8_t *rom, uint16_t *temperature,
+                     uint16_t *age_ms);
 void encode_response_owi_get_res(packet_t *packet, uint8_t res);
 void decode_response_owi_get_res(packet_t *packet, uint8_t *res);
-void encode_cmd_ec_measure(packet_t *packet);
-void encode_cmd_ec_import_calib(packet_t *packet, uint8_t *data,
-                                uint8_t length);
-void encode_cmd_ec_export_calib(packet_t *packet);
-void encode_cmd_ec_clear_calib(packet_t *packet);
-void encode_cmd_ec_calib_dry(packet_t *packet);
-void encode_cmd_ec_calib_low(packet_t *packet);
-void encode_cmd_ec_calib_high(packet_t *packet);
-void encode_cmd_ec_compensation(packet_t *packet, float temperature);
-void decode_cmd_ec_compensation(packet_t *packet, float *temperature);
-void encode_data_ec(packet_t *packet, uint32_t value);
+void encode_cmd_owi_set_sampling(packet_t *packet, uint32_t period_ms,
+                                 uint32_t max_age_ms);
+void encode_cmd_owi_set_alarm(packet_t *packet, uint8_t *rom, int8_t high,
+                              int8_t low);
+void decode_cmd_owi_set_alarm(packet_t *packet, uint8_t *rom, int8_t *high,
+                              int8_t *low);
+void encode_cmd_owi_measure_alarms(packet_t *packet);
+void encode_response_owi_measure_alarms(packet_t *packet, uint8_t n_alarms);
+void decode_response_owi_measure_alarms(packet_t *packet, uint8_t *n_alarms);
+void encode_cmd_owi_set_read_mode(packet_t *packet, uint8_t mode);
+void decode_cmd_owi_set_read_mode(packet_t *packet, uint8_t *mode);
+void encode_cmd_owi_get_stats(packet_t *packet);
+void encode_cmd_owi_set_profile(packet_t *packet, uint8_t *rom, uint8_t res,
+                                uint8_t adaptive);
+void decode_cmd_owi_set_profile(packet_t *packet, uint8_t *rom, uint8_t *res,
+                                uint8_t *adaptive);
+void encode_response_owi_get_stats(packet_t *packet, uint8_t mode,
+                                   uint16_t reads, uint16_t crc_errors,
+                                   uint16_t retries);
+void decode_response_owi_get_stats(packet_t *packet, uint8_t *mode,
+                                   uint16_t *reads, uint16_t *crc_errors,
+                                   uint16_t *retries);
+void decode_cmd_owi_set_sampling(packet_t *packet, uint32_t *period_ms,
+                                 uint32_t *max_age_ms);
+void decode_cmd_device(packet_t *packet, uint8_t *device);
+void encode_cmd_ec_measure(packet_t *packet, uint8_t device);
+void encode_cmd_ec_import_calib(packet_t *packet, uint8_t device,
+                                uint8_t chunk, uint8_t n_chunks,
+                                const uint8_t *data, uint8_t length);
+void decode_cmd_ec_import_calib(packet_t *packet, uint8_t *device,
+                                uint8_t *chunk, uint8_t *n_chunks,
+                                uint8_t *data, uint8_t *length);
+void encode_cmd_ec_export_calib(packet_t *packet, uint8_t device);
+void encode_cmd_ec_clear_calib(packet_t *packet, uint8_t device);
+void encode_cmd_ec_calib_dry(packet_t *packet, uint8_t device);
+void encode_cmd_ec_calib_low(packet_t *packet, uint8_t device);
+void encode_cmd_ec_calib_high(packet_t *packet, uint8_t device);
+void encode_cmd_ec_compensation(packet_t *packet, uint8_t device,
+                                int16_t centi_degrees);
+void decode_cmd_ec_compensation(packet_t *packet, uint8_t *device,
+                                int16_t *centi_degrees);
+void encode_data_ec(packet_t *packet, uint8_t device, uint32_t value);
+void encode_cmd_water_measure(packet_t *packet);
+void encode_data_water(packet_t *packet, uint8_t count, uint8_t valid,
+                       const uint8_t *types, const uint32_t *values);
+void decode_data_water(packet_t *packet, uint8_t *count, uint8_t *valid,
+                       uint8_t *types, uint32_t *values);
+void encode_cmd_water_set_sensors(packet_t *packet, uint8_t device,
+                                  uint8_t count, const uint8_t (*roms)[8]);
+void decode_cmd_water_set_sensors(packet_t *packet, uint8_t *device,
+                                  uint8_t *count, uint8_t (*roms)[8]);
+void encode_cmd_probe_set_device(packet_t *packet, uint8_t device,
+                                 uint8_t type, uint8_t address,
+                                 uint8_t uart_id, uint8_t enable_port,
+                                 uint8_t enable_pin);
+void decode_cmd_probe_set_device(packet_t *packet, uint8_t *device,
+                                 uint8_t *type, uint8_t *address,
+                                 uint8_t *uart_id, uint8_t *enable_port,
+                                 uint8_t *enable_pin);
 void encode_response_ec_get_calib_format(packet_t *packet, uint8_t n_strings,
                                          uint8_t n_bytes);
-void encode_response_ec_export_calib(packet_t *packet, uint8_t *data,
-                                     uint8_t length);
-void encode_cmd_ph_measure(packet_t *packet);
+void encode_response_ec_export_calib(packet_t *packet, uint8_t device,
+                                     uint8_t chunk, uint8_t n_chunks,
+                                     const uint8_t *data, uint8_t length);
+void decode_response_ec_export_calib(packet_t *packet, uint8_t *device,
+                                     uint8_t *chunk, uint8_t *n_chunks,
+                                     uint8_t *data, uint8_t *length);
+void encode_cmd_ph_measure(packet_t *packet, uint8_t device);
 void encode_cmd_ph_get_calib_format(packet_t *packet);
-void encode_cmd_ph_import_calib(packet_t *packet, uint8_t *data,
-                                uint8_t length);
-void encode_cmd_ph_export_calib(packet_t *packet);
-void encode_cmd_ph_clear_calib(packet_t *packet);
-void encode_cmd_ph_calib_low(packet_t *packet);
-void encode_cmd_ph_calib_mid(packet_t *packet);
-void encode_cmd_ph_calib_high(packet_t *packet);
-void encode_cmd_ph_compensation(packet_t *packet, float temperature);
-void decode_cmd_ph_compensation(packet_t *packet, float *temperature);
-void encode_data_ph(packet_t *packet, uint32_t data);
+void encode_cmd_ph_import_calib(packet_t *packet, uint8_t device,
+                                uint8_t chunk, uint8_t n_chunks,
+                                const uint8_t *data, uint8_t length);
+void decode_cmd_ph_import_calib(packet_t *packet, uint8_t *device,
+                                uint8_t *chunk, uint8_t *n_chunks,
+                                uint8_t *data, uint8_t *length);
+void encode_cmd_ph_export_calib(packet_t *packet, uint8_t device);
+void encode_cmd_ph_clear_calib(packet_t *packet, uint8_t device);
+void encode_cmd_ph_calib_low(packet_t *packet, uint8_t device);
+void encode_cmd_ph_calib_mid(packet_t *packet, uint8_t device);
+void encode_cmd_ph_calib_high(packet_t *packet, uint8_t device);
+void encode_cmd_ph_compensation(packet_t *packet, uint8_t device,
+                                int16_t centi_degrees);
+void decode_cmd_ph_compensation(packet_t *packet, uint8_t *device,
+                                int16_t *centi_degrees);
+void encode_data_ph(packet_t *packet, uint8_t device, uint32_t value);
 void encode_response_ph_get_calib_format(packet_t *packet, uint8_t n_strings,
                                          uint8_t n_bytes);
-void encode_response_ph_export_calib(packet_t *packet, uint8_t *data,
-                                     uint8_t length);
+void encode_response_ph_export_calib(packet_t *packet, uint8_t device,
+                                     uint8_t chunk, uint8_t n_chunks,
+                                     const uint8_t *data, uint8_t length);
+void decode_response_ph_export_calib(packet_t *packet, uint8_t *device,
+                                     uint8_t *chunk, uint8_t *n_chunks,
+                                     uint8_t *data, uint8_t *length);
 void encode_cmd_light_set(packet_t *packet, uint8_t state);
 void decode_cmd_light_set(packet_t *packet, uint8_t *state);
 void encode_cmd_light_get(packet_t *packet);
@@ -137,6 +221,37 @@ void encode_cmd_fan_get_speed(packet_t *packet, uint8_t index);
 void decode_cmd_fan_get_speed(packet_t *packet, uint8_t *index);
 void encode_response_fan_get_speed(packet_t *packet, uint8_t index,
                                    uint16_t speed);
+void encode_cmd_fan_set_speeds(packet_t *packet, uint8_t count,
+                               const uint8_t *indices, const uint16_t *speeds);
+void decode_cmd_fan_set_speeds(packet_t *packet, uint8_t *count,
+                               uint8_t *indices, uint16_t *speeds);
+void encode_cmd_pwm_ramp(packet_t *packet, uint8_t index, uint16_t target,
+                         uint32_t duration_ms, uint8_t curve);
+void decode_cmd_pwm_ramp(packet_t *packet, uint8_t *index, uint16_t *target,
+                         uint32_t *duration_ms, uint8_t *curve);
+void encode_cmd_fan_control_set_levels(packet_t *packet, uint8_t count,
+                                       const int16_t *lows,
+                                       const int16_t *highs,
+                                       const uint16_t *pwms);
+void decode_cmd_fan_control_set_levels(packet_t *packet, uint8_t *count,
+                                       int16_t *lows, int16_t *highs,
+                                       uint16_t *pwms);
+void encode_cmd_fan_control_set_sensors(packet_t *packet, uint8_t count,
+                                        const uint8_t (*roms)[8]);
+void decode_cmd_fan_control_set_sensors(packet_t *packet, uint8_t *count,
+                                        uint8_t (*roms)[8]);
+void encode_cmd_fan_control_enable(packet_t *packet, uint8_t enabled,
+                                   uint16_t channels);
+void decode_cmd_fan_control_enable(packet_t *packet, uint8_t *enabled,
+                                   uint16_t *channels);
+void encode_cmd_fan_control_get_state(packet_t *packet);
+void encode_response_fan_control_get_state(packet_t *packet, uint8_t enabled,
+                                           uint8_t level, int16_t temperature,
+                                           uint16_t pwm);
+void decode_response_fan_control_get_state(packet_t *packet, uint8_t *enabled,
+                                           uint8_t *level,
+                                           int16_t *temperature,
+                                           uint16_t *pwm);
 void decode_response_fan_get_speed(packet_t *packet, uint8_t *index,
                                    uint16_t *speed);
 void encode_ready_request(packet_t *packet);
@@ -7,6 +7,12 @@
 void handle_cmd_owi_set_res(packet_t *packet);
 void handle_cmd_owi_get_res(packet_t *packet);
 void handle_cmd_owi_measure(packet_t *packet);
+void handle_cmd_owi_set_sampling(packet_t *packet);
+void handle_cmd_owi_set_alarm(packet_t *packet);
+void handle_cmd_owi_measure_alarms(packet_t *packet);
+void handle_cmd_owi_set_read_mode(packet_t *packet);
+void handle_cmd_owi_get_stats(packet_t *packet);
+void handle_cmd_owi_set_profile(packet_t *packet);
 void handle_cmd_ec_measure(packet_t *packet);
 void handle_cmd_ec_import_calib(packet_t *packet);
 void handle_cmd_ec_export_calib(packet_t *packet);
@@ -16,6 +22,9 @@ void handle_cmd_ec_calib_low(packet_t *packet);
 void handle_cmd_ec_calib_high(packet_t *packet);
 void handle_cmd_ec_compensation(packet_t *packet);
 void handle_cmd_ph_measure(packet_t *packet);
+void handle_cmd_water_measure(packet_t *packet);
+void handle_cmd_water_set_sensors(packet_t *packet);
+void handle_cmd_probe_set_device(packet_t *packet);
 void handle_cmd_ph_import_calib(packet_t *packet);
 void handle_cmd_ph_export_calib(packet_t *packet);
 void handle_cmd_ph_clear_calib(packet_t *packet);
@@ -32,6 +41,12 @@ void handle_cmd_light_red_get(packet_t *packet);
 void handle_cmd_light_white_set(packet_t *packet);
 void handle_cmd_light_white_get(packet_t *packet);
 void handle_cmd_fan_set_speed(packet_t *packet);
+void handle_cmd_fan_set_speeds(packet_t *packet);
+void handle_cmd_pwm_ramp(packet_t *packet);
+void handle_cmd_fan_control_set_levels(packet_t *packet);
+void handle_cmd_fan_control_set_sensors(packet_t *packet);
+void handle_cmd_fan_control_enable(packet_t *packet);
+void handle_cmd_fan_control_get_state(packet_t *packet);
 void handle_cmd_fan_get_speed(packet_t *packet);
 void handle_cmd_unknown(packet_t *packet);
 
@@ -0,0 +1,71 @@
+#ifndef PROBE_H_
+#define PROBE_H_
+
+#include "common.h"
+#include "ezo.h"
+
+#define PROBE_MAX_DEVICES 4
+
+typedef enum {
+    PROBE_TYPE_NONE,
+    PROBE_TYPE_EC,
+    PROBE_TYPE_PH
+} probe_type_t;
+
+/**
+ * @brief Calibration points of the circuits. Not every type supports every
+ * point.
+ */
+typedef enum {
+    PROBE_CALIBRATION_CLEAR,
+    PROBE_CALIBRATION_DRY,
+    PROBE_CALIBRATION_LOW,
+    PROBE_CALIBRATION_MID,
+    PROBE_CALIBRATION_HIGH,
+    PROBE_N_CALIBRATIONS
+} probe_calibration_t;
+
+/**
+ * @brief Called with the result of @ref probe_read().
+ *
+ * @param index Index of the circuit in the device table.
+ * @param value Conductivity in uS/cm or pH in thousandths.
+ */
+typedef void (*probe_callback_t)(uint8_t index, return_status_t status,
+                                 uint32_t value);
+
+/**
+ * @brief Entry of the device table.
+ */
+typedef struct {
+    uint8_t type;     ///< One of @ref probe_type_t.
+    uint8_t address;  ///< I2C address of the circuit.
+    uint8_t uart_id;  ///< USART of a circuit in UART mode, 0 in I2C mode.
+    uint8_t enable_port;  ///< Letter of the port of the enable pin, 0 if none.
+    uint8_t enable_pin;
+} probe_config_t;
+
+void probe_init();
+return_status_t probe_set_device(uint8_t index, const probe_config_t *config);
+probe_type_t probe_type(uint8_t index);
+ezo_t *probe_device(uint8_t index, probe_type_t type);
+uint8_t probe_index(const ezo_t *ezo);
+return_status_t probe_read(uint8_t index, probe_type_t type,
+                           probe_callback_t callback);
+return_status_t probe_calibrate(uint8_t index, probe_type_t type,
+                                probe_calibration_t point);
+return_status_t probe_calibration_export(uint8_t index, probe_type_t type,
+                                         ezo_calibration_callback_t callback);
+return_status_t probe_calibration_import(uint8_t index, probe_type_t type,
+                                         uint8_t chunk, uint8_t n_chunks,
+                                         const uint8_t *data, uint8_t length,
+                                         ezo_calibration_callback_t callback);
+return_status_t probe_calibration_restore(uint8_t index, probe_type_t type,
+                                          ezo_calibration_callback_t callback);
+uint8_t probe_calibration_chunk(uint8_t index, uint8_t chunk, uint8_t *data,
+                                uint8_t *n_chunks);
+return_status_t probe_temperature_compensation(uint8_t index,
+                                               probe_type_t type,
+                                               int16_t centi_degrees);
+
+#endif /* PROBE_H_ */
@@ -3,7 +3,42 @@
 
 #include <stdint.h>
 
+#include "common.h"
+
+#define PWM_MAX_CHANNELS 16
+/**
+ * @brief Largest off time of a channel. 4096 sets the full on bit of the
+ * PCA9685.
+ */
+#define PWM_MAX_VALUE 4096
+
+/**
+ * @brief Interval in which running ramps update their channels.
+ */
+#define PWM_RAMP_TICK_MS 20
+
+/**
+ * @brief Shape of a ramp over its duration.
+ *
+ * - #PWM_CURVE_LINEAR changes the value at a constant rate.
+ * - #PWM_CURVE_EASE_IN_OUT starts and ends slowly (smoothstep).
+ * - #PWM_CURVE_QUADRATIC starts slowly and speeds up, which looks more even
+ * on LEDs than a linear ramp.
+ */
+enum pwm_curve_e {
+    PWM_CURVE_LINEAR,
+    PWM_CURVE_EASE_IN_OUT,
+    PWM_CURVE_QUADRATIC
+};
+
+typedef enum pwm_curve_e pwm_curve_t;
+
 void pwm_init();
+void pwm_stage(uint8_t index, uint16_t pwm);
+void pwm_flush();
 void pwm_set(uint8_t index, uint16_t pwm);
 void pwm_get(uint8_t index, uint16_t *pwm);
+return_status_t pwm_ramp(uint8_t index, uint16_t target, uint32_t duration_ms,
+                         pwm_curve_t curve);
+uint8_t pwm_ramping(uint8_t index);
 #endif /* PWM */
@@ -6,12 +6,6 @@
         return x;           \
     }
 
-#define ASSERT_SUCCESS_TWI_STOP(x) \
-    if (status != RET_SUCCESS) {   \
-        twi_stop();                \
-        return status;             \
-    }
-
 typedef enum {
     RET_SUCCESS,
 
@@ -20,19 +14,51 @@ typedef enum {
     RET_OWI_CRC_ERR,
     RET_OWI_INVALID_FAMILY_CODE,
     RET_OWI_SEARCH_LAST_DEVICE,
+    RET_OWI_BUSY,
+    RET_OWI_TIMEOUT,
+    RET_OWI_UNKNOWN_DEVICE,
 
     RET_TWI_NO_ACK,
     RET_TWI_START_ERR,
+    RET_TWI_BUSY,
+    RET_TWI_TIMEOUT,
+    RET_TWI_BUS_ERR,
+    RET_TWI_TOO_MANY_DEVICES,
 
     RET_PACKET_MINIMAL_LENGTH_ERR,
     RET_PACKET_LENGTH_MISMATCH,
     RET_PACKET_CRC_ERR,
 
-    RET_PH_SYNTAX_ERR,
-    RET_PH_NO_RESPONSE,
+    RET_SERIAL_NO_PACKET,
+
+    RET_SCHEDULER_FULL,
+
+    RET_FIXED_SYNTAX_ERR,
+    RET_FIXED_OVERFLOW,
+
+    RET_COMPENSATION_TOO_MANY,
+
+    RET_PROBE_INVALID_DEVICE,
+    RET_PROBE_INVALID_CONFIG,
+
+    RET_EZO_SYNTAX_ERR,
+    RET_EZO_NO_RESPONSE,
+    RET_EZO_UNEXPECTED_RESPONSE,
+    RET_EZO_TIMEOUT,
+    RET_EZO_QUEUE_FULL,
+    RET_EZO_COMMAND_TOO_LONG,
+    RET_EZO_BUSY,
+    RET_EZO_BUFFER_OVERFLOW,
+    RET_EZO_UNSUPPORTED,
+    RET_EZO_NO_CALIBRATION,
+    RET_EZO_CHUNK_SEQUENCE_ERR,
+
+    RET_PWM_INVALID_CHANNEL,
+    RET_PWM_INVALID_CURVE,
+    RET_PWM_INVALID_VALUE,
 
-    RET_EC_SYNTAX_ERR,
-    RET_EC_NO_RESPONSE
+    RET_FAN_CONTROL_TOO_MANY,
+    RET_FAN_CONTROL_INVALID_LEVEL
 
 } return_status_t;
 #endif /* RETURN */
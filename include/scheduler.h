@@ -0,0 +1,31 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "common.h"
+
+#define SCHEDULER_MAX_TASKS 16
+
+typedef struct task_s task_t;
+
+/**
+ * @brief A cooperative task.
+ *
+ * @ref task_s.poll is called whenever the task is due and has to return
+ * quickly. It decides when it wants to run again by calling
+ * @ref scheduler_sleep() or @ref scheduler_suspend(); otherwise it is polled
+ * again on the next pass of the run queue.
+ */
+struct task_s {
+    void (*poll)(task_t *task);
+    uint32_t next_due;
+    uint8_t active;
+};
+
+return_status_t scheduler_add(task_t *task, void (*poll)(task_t *task));
+void scheduler_sleep(task_t *task, uint32_t ms);
+void scheduler_wake(task_t *task);
+void scheduler_suspend(task_t *task);
+void scheduler_resume(task_t *task);
+void scheduler_run();
+
+#endif /* SCHEDULER_H_ */
@@ -32,9 +32,11 @@ void serial_debug(serial_log_source_t source, const char *format, ...);
 void serial_info(serial_log_source_t source, const char *format, ...);
 void serial_warning(serial_log_source_t source, const char *format, ...);
 void serial_error(serial_log_source_t source, const char *format, ...);
-void serial_send_raw(uint8_t *data);
+void serial_send_raw(uint8_t *data, uint8_t length);
 void serial_send_packet(packet_t *packet);
 void serial_read_packet(packet_t *packet);
+uint8_t serial_packet_available();
+return_status_t serial_poll_packet(packet_t *packet);
 void serial_send_packet(packet_t *packet);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef TEMPERATURE_H_
+#define TEMPERATURE_H_
+
+#include "owi.h"
+
+#define TEMPERATURE_MAX_DEVICES 16
+
+/**
+ * @brief Latest reading of a sensor together with the time it was read.
+ */
+typedef struct {
+    ds18b20_t device;
+    uint8_t line;  ///< Pin number of the OWI line the sensor is connected to.
+    uint32_t timestamp_ms;
+    owi_resolution_t resolution;  ///< Resolution of the sensor's profile.
+    uint8_t adaptive;  ///< Drop to 9 bit while the reading is stable.
+    uint8_t n_stable;  ///< Number of readings close to #reference.
+    uint16_t reference;
+} temperature_sample_t;
+
+typedef void (*temperature_callback_t)(temperature_sample_t *sample);
+typedef void (*temperature_alarms_callback_t)(uint8_t n_alarms);
+
+void temperature_init(owi_bus_t *owi_bus);
+void temperature_set_listener(temperature_callback_t listener);
+const temperature_sample_t *temperature_latest(const uint8_t *rom);
+return_status_t temperature_measure(temperature_callback_t callback);
+return_status_t temperature_measure_alarms(temperature_callback_t callback,
+                                           temperature_alarms_callback_t done);
+void temperature_set_sampling(uint32_t period_ms, uint32_t max_age_ms);
+void temperature_set_read_mode(owi_read_mode_t mode);
+owi_read_mode_t temperature_get_read_mode();
+void temperature_get_stats(owi_stats_t *stats);
+return_status_t temperature_set_alarm(const uint8_t *rom, int8_t high,
+                                      int8_t low);
+return_status_t temperature_set_resolution(owi_resolution_t resolution);
+return_status_t temperature_set_profile(const uint8_t *rom,
+                                        owi_resolution_t resolution,
+                                        uint8_t adaptive);
+uint8_t temperature_busy();
+
+#endif /* TEMPERATURE_H_ */
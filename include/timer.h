@@ -0,0 +1,14 @@
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+
+void timer_init();
+uint32_t timer_now_ms();
+uint32_t timer_now_us();
+uint32_t timer_deadline_ms(uint32_t timeout_ms);
+uint8_t timer_expired(uint32_t deadline_ms);
+uint32_t timer_elapsed_ms(uint32_t since_ms);
+uint32_t timer_elapsed_us(uint32_t since_us);
+
+#endif /* TIMER_H_ */
@@ -3,14 +3,69 @@
 
 #include "common.h"
 
+/**
+ * @brief Time a transaction may occupy the bus if it does not set its own
+ * timeout.
+ */
+#define TWI_DEFAULT_TIMEOUT_MS 20
+
+/**
+ * @brief SCL frequency for slaves that have not been registered with @ref
+ * twi_register_device().
+ */
+#define TWI_DEFAULT_CLOCK_HZ 100000UL
+/**
+ * @brief Highest SCL frequency supported by the TWI peripheral. Faster
+ * devices are clocked with this frequency.
+ */
+#define TWI_MAX_CLOCK_HZ 400000UL
+#define TWI_MAX_DEVICES 8
+
+typedef struct twi_transaction_s twi_transaction_t;
+
+typedef void (*twi_callback_t)(twi_transaction_t *transaction);
+
+/**
+ * @brief An I2C master transaction.
+ *
+ * The #write_length bytes of #write_data are written first, then
+ * #read_length bytes are read into #read_data after a repeated start. Either
+ * part may be empty, a transaction without any data only addresses the
+ * slave.
+ *
+ * The transaction and its buffers belong to the caller and have to stay
+ * unchanged while #status is @ref RET_TWI_BUSY.
+ */
+struct twi_transaction_s {
+    uint8_t address;
+    const uint8_t *write_data;
+    uint8_t write_length;
+    uint8_t *read_data;
+    uint8_t read_length;
+    /**
+     * @brief Time the transaction may take once it has been started on the
+     * bus. 0 selects #TWI_DEFAULT_TIMEOUT_MS.
+     */
+    uint16_t timeout_ms;
+    /**
+     * @brief Called from the TWI task when the transaction is done. May be
+     * `NULL`.
+     */
+    twi_callback_t callback;
+    void *context;  ///< Free for the owner of the transaction.
+    volatile return_status_t status;
+    uint32_t deadline;
+    twi_transaction_t *next;
+};
+
 void twi_init();
-return_status_t twi_start_write(uint8_t slave_address);
-return_status_t twi_start_read(uint8_t slave_address);
-return_status_t twi_write(uint8_t *data, uint8_t length);
-return_status_t twi_write_byte(uint8_t data);
-return_status_t twi_read(uint8_t *data, uint8_t length);
-return_status_t twi_read_ack(uint8_t *data);
-return_status_t twi_read_nack(uint8_t *data);
-void twi_stop();
+return_status_t twi_register_device(uint8_t address, uint32_t max_clock_hz);
+void twi_transaction_init(twi_transaction_t *transaction, uint8_t address,
+                          const uint8_t *write_data, uint8_t write_length,
+                          uint8_t *read_data, uint8_t read_length);
+return_status_t twi_submit(twi_transaction_t *transaction);
+return_status_t twi_wait(twi_transaction_t *transaction);
+return_status_t twi_transfer(twi_transaction_t *transaction);
+uint8_t twi_busy();
 
 #endif /* TWI_H_ */
@@ -5,6 +5,9 @@
 
 #define NO_OF_UARTS 4
 
+// must stay 256 so the uint8_t ring indices wrap for free
+#define UART_0_TX_BUFFER_SIZE 256
+
 uint8_t uart_init(uint8_t uart_id, uint32_t baud);
 
 void uart_0_set_receive_callback(void (*receive_callback)(char));
@@ -32,4 +35,9 @@ void uart_1_puts(char *string);
 void uart_2_puts(char *string);
 void uart_3_puts(char *string);
 
+uint8_t uart_0_tx_free();
+uint8_t uart_0_try_write(const uint8_t *data, uint8_t length);
+void uart_0_write(const uint8_t *data, uint8_t length);
+void uart_0_flush();
+
 #endif
@@ -33,7 +33,7 @@ class SensorCtrl(QtCore.QObject):
     @QtCore.pyqtSlot(object)
     def on_ec_data(self, packet):
         self.data_mutex.lock()
-        self.ec["value"] = pkt.decode_data_ec(packet)
+        self.ec["value"] = pkt.decode_data_ec(packet)["ec"]
         self.ec["timestamp"] = time.time()
         self.new_ec_data.emit(self.ec["value"])
         self.data_mutex.unlock()
@@ -41,7 +41,7 @@ class SensorCtrl(QtCore.QObject):
     @QtCore.pyqtSlot(object)
     def on_ph_data(self, packet):
         self.data_mutex.lock()
-        self.ph["value"] = pkt.decode_data_ph(packet)
+        self.ph["value"] = pkt.decode_data_ph(packet)["ph"]
         self.ph["timestamp"] = time.time()
         self.new_ph_data.emit(self.ph["value"])
         self.data_mutex.unlock()
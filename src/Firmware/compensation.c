@@ -0,0 +1,107 @@
+/**
+ * @file compensation.c
+ * @brief Water temperature for the compensation of the EZO probes.
+ *
+ * Each EZO circuit of the device table is mapped to the DS18B20 sensors in the
+ * water around its probe. The mapping is kept in EEPROM. Before a reading, the
+ * circuit asks for the mean of the recent readings of its sensors and sends it
+ * along with the read command, so compensation stays current without a round
+ * trip to the host.
+ *
+ * Like the fan control, this module does not start measurements itself. It
+ * relies on the background sampling of the temperature module.
+ */
+#include "compensation.h"
+
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "probe.h"
+#include "temperature.h"
+#include "timer.h"
+
+#define EEPROM_MAGIC 0xA5
+#define ROM_SIZE 8
+
+static uint8_t roms[PROBE_MAX_DEVICES][COMPENSATION_MAX_SENSORS][ROM_SIZE];
+static uint8_t n_sensors[PROBE_MAX_DEVICES];
+
+static uint8_t ee_magic EEMEM;
+static uint8_t ee_n_sensors[PROBE_MAX_DEVICES] EEMEM;
+static uint8_t ee_roms[PROBE_MAX_DEVICES][COMPENSATION_MAX_SENSORS][ROM_SIZE]
+    EEMEM;
+
+void compensation_init() {
+    uint8_t count;
+    if (eeprom_read_byte(&ee_magic) != EEPROM_MAGIC) {
+        return;
+    }
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        count = eeprom_read_byte(&ee_n_sensors[i]);
+        if (count > COMPENSATION_MAX_SENSORS) {
+            continue;
+        }
+        eeprom_read_block(roms[i], ee_roms[i], ROM_SIZE * count);
+        n_sensors[i] = count;
+    }
+}
+
+/**
+ * @brief Maps the circuit at @p index of the device table to the water sensors
+ * in @p new_roms and stores the mapping in EEPROM. A @p count of 0 leaves the
+ * compensation to the host.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_COMPENSATION_TOO_MANY
+ * - @ref RET_PROBE_INVALID_DEVICE
+ */
+return_status_t compensation_set_sensors(uint8_t index,
+                                         const uint8_t (*new_roms)[8],
+                                         uint8_t count) {
+    if (index >= PROBE_MAX_DEVICES) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    if (count > COMPENSATION_MAX_SENSORS) {
+        return RET_COMPENSATION_TOO_MANY;
+    }
+    memcpy(roms[index], new_roms, ROM_SIZE * count);
+    n_sensors[index] = count;
+    eeprom_update_block(roms[index], ee_roms[index], ROM_SIZE * count);
+    eeprom_update_byte(&ee_n_sensors[index], count);
+    eeprom_update_byte(&ee_magic, EEPROM_MAGIC);
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Averages the recent readings of the water sensors of the circuit at
+ * @p index.
+ *
+ * @param[out] centi_degrees Water temperature in 1/100 degree Celsius.
+ * @return uint8_t `false` if none of the sensors has a recent reading.
+ */
+uint8_t compensation_get(uint8_t index, int16_t *centi_degrees) {
+    const temperature_sample_t *sample;
+    int32_t sum = 0;
+    uint8_t count = 0;
+    if (index >= PROBE_MAX_DEVICES) {
+        return false;
+    }
+    for (uint8_t i = 0; i < n_sensors[index]; i++) {
+        sample = temperature_latest(roms[index][i]);
+        if (sample == NULL ||
+            timer_elapsed_ms(sample->timestamp_ms) > COMPENSATION_MAX_AGE_MS) {
+            continue;
+        }
+        sum += (int16_t)sample->device.temperature;
+        count++;
+    }
+    if (count == 0) {
+        return false;
+    }
+    // 1/16 degree to 1/100 degree
+    *centi_degrees = (int16_t)(sum * 25 / (4 * count));
+    return true;
+}
@@ -0,0 +1,691 @@
+/**
+ * @file ezo.c
+ * @brief Non-blocking driver for Atlas Scientific EZO circuits in I2C mode.
+ *
+ * An EZO circuit takes a command, processes it for up to about a second and
+ * then holds a response that starts with a status code. Each circuit has its
+ * own task that writes the next queued command, sleeps for the processing
+ * time of the command, reads the response and polls it again while the
+ * circuit reports that it is still processing. The response is handed to the
+ * callback of the command, so the rest of the firmware keeps running while
+ * the circuits convert.
+ *
+ * In UART mode the circuit is switched to continuous readings. The receive
+ * interrupt assembles the lines of the circuit and stores readings in the
+ * latest value slot and response codes (`*OK`, `*ER`) for the task. Other
+ * commands are written to the USART and completed by their response code.
+ * A compensated reading (`RT`) is answered from the latest value slot once the
+ * circuit acknowledges it and the slot holds a reading received after the
+ * command was written, since its reading arrives just before the code.
+ *
+ * Exported calibrations are mirrored to an EEPROM cache of the owner of the
+ * circuit. The host transfers them in chunks that fit into a packet, and a
+ * replaced probe gets the cached calibration back with one import.
+ */
+#include "ezo.h"
+
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/atomic.h>
+
+#include "fixed.h"
+#include "timer.h"
+#include "uart.h"
+
+#define TWI_CLOCK_HZ 400000UL
+
+#define RESPONSE_NO_DATA_TO_SEND 255
+#define RESPONSE_STILL_PROCESSING 254
+#define RESPONSE_SYNTAX_ERROR 2
+#define RESPONSE_SUCCESS 1
+
+#define EEPROM_MAGIC 0xA5
+
+#if defined(OWI_UART) && (defined(EC_UART) && EC_UART == 1 || \
+                          defined(PH_UART) && PH_UART == 1)
+#error "USART1 is used by the OWI bus"
+#endif
+
+/**
+ * @brief Circuit in UART mode on each USART, indexed by the USART number.
+ */
+static ezo_t *uart_circuits[NO_OF_UARTS];
+
+/**
+ * @brief Calibration strings of the circuit in #exporting.
+ */
+static ezo_t *exporting = NULL;
+static uint8_t export_buffer[EZO_CALIBRATION_SIZE];
+static uint8_t export_length;
+
+static void ezo_transfer_done(twi_transaction_t *transaction) {
+    ezo_t *ezo = transaction->context;
+    scheduler_wake(&ezo->task);
+}
+
+/**
+ * @brief Removes the current command from the queue and hands the response
+ * to its callback.
+ */
+static void ezo_finish(ezo_t *ezo, return_status_t status) {
+    ezo_command_t *command = &ezo->queue[ezo->head];
+    ezo_callback_t callback = command->callback;
+    void *context = command->context;
+    ezo->head = (ezo->head + 1) % EZO_QUEUE_LENGTH;
+    ezo->count--;
+    ezo->state = EZO_IDLE;
+    if (status != RET_SUCCESS) {
+        ezo->response[1] = '\0';
+    }
+    // the callback may queue the next command
+    if (callback != NULL) {
+        callback(ezo, status, &ezo->response[1], context);
+    }
+}
+
+/**
+ * @brief Writes the current command or reads its response, depending on the
+ * state.
+ */
+static void ezo_start_transfer(ezo_t *ezo) {
+    ezo_command_t *command = &ezo->queue[ezo->head];
+    return_status_t status;
+    if (ezo->state == EZO_WRITING) {
+        twi_transaction_init(&ezo->transaction, ezo->address,
+                             (const uint8_t *)command->command,
+                             strlen(command->command), NULL, 0);
+    } else {
+        // the circuit pads the response with zeros
+        twi_transaction_init(&ezo->transaction, ezo->address, NULL, 0,
+                             (uint8_t *)ezo->response,
+                             EZO_MAX_RESPONSE_LENGTH);
+    }
+    ezo->transaction.callback = ezo_transfer_done;
+    ezo->transaction.context = ezo;
+    status = twi_submit(&ezo->transaction);
+    if (status != RET_SUCCESS) {
+        ezo_finish(ezo, status);
+        return;
+    }
+    scheduler_suspend(&ezo->task);
+}
+
+/**
+ * @brief Evaluates the status code of a response.
+ */
+static void ezo_parse_response(ezo_t *ezo) {
+    ezo->response[EZO_MAX_RESPONSE_LENGTH] = '\0';
+    switch ((uint8_t)ezo->response[0]) {
+        case RESPONSE_SUCCESS:
+            ezo_finish(ezo, RET_SUCCESS);
+            break;
+        case RESPONSE_STILL_PROCESSING:
+            if (++ezo->polls > EZO_MAX_POLLS) {
+                ezo_finish(ezo, RET_EZO_TIMEOUT);
+                break;
+            }
+            serial_debug(ezo->source, "Still processing %s",
+                         ezo->queue[ezo->head].command);
+            ezo->state = EZO_WAITING;
+            scheduler_sleep(&ezo->task, EZO_POLL_INTERVAL_MS);
+            break;
+        case RESPONSE_SYNTAX_ERROR:
+            ezo_finish(ezo, RET_EZO_SYNTAX_ERR);
+            break;
+        case RESPONSE_NO_DATA_TO_SEND:
+            ezo_finish(ezo, RET_EZO_NO_RESPONSE);
+            break;
+        default:
+            ezo_finish(ezo, RET_EZO_UNEXPECTED_RESPONSE);
+            break;
+    }
+}
+
+static uint8_t ezo_is_reading(const char *line) {
+    return (line[0] >= '0' && line[0] <= '9') || line[0] == '-' ||
+           line[0] == '.';
+}
+
+/**
+ * @brief Handles a received character of a circuit in UART mode.
+ *
+ * Called from the receive interrupt of its USART.
+ */
+static void ezo_receive(ezo_t *ezo, char c) {
+    if (ezo == NULL) {
+        return;
+    }
+    if (c != '\r') {
+        if (ezo->rx_length < EZO_MAX_RESPONSE_LENGTH) {
+            ezo->rx[ezo->rx_length++] = c;
+        }
+        return;
+    }
+    ezo->rx[ezo->rx_length] = '\0';
+    if (ezo->rx_length == 0) {
+        return;
+    }
+    ezo->rx_length = 0;
+    if (ezo_is_reading(ezo->rx)) {
+        memcpy(ezo->reading, ezo->rx, sizeof(ezo->reading));
+        ezo->reading_ms = timer_now_ms();
+        ezo->reading_valid = true;
+    } else if (strcmp(ezo->rx, "*OK") == 0) {
+        ezo->response_code = RESPONSE_SUCCESS;
+    } else if (strcmp(ezo->rx, "*ER") == 0) {
+        ezo->response_code = RESPONSE_SYNTAX_ERROR;
+    } else if (ezo->rx[0] != '*' && ezo->state == EZO_WAITING) {
+        // e.g. the answer to a query, followed by its response code
+        memcpy(&ezo->response[1], ezo->rx, EZO_MAX_RESPONSE_LENGTH);
+    }
+}
+
+static void ezo_uart_1_receive(char c) { ezo_receive(uart_circuits[1], c); }
+static void ezo_uart_2_receive(char c) { ezo_receive(uart_circuits[2], c); }
+static void ezo_uart_3_receive(char c) { ezo_receive(uart_circuits[3], c); }
+
+static void ezo_uart_puts(uint8_t uart_id, char *string) {
+    switch (uart_id) {
+        case 1:
+            uart_1_puts(string);
+            break;
+        case 2:
+            uart_2_puts(string);
+            break;
+        case 3:
+            uart_3_puts(string);
+            break;
+    }
+}
+
+/**
+ * @brief Answers an `R` command from the latest continuous reading.
+ */
+static void ezo_uart_finish_reading(ezo_t *ezo) {
+    uint8_t valid;
+    uint32_t reading_ms;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        valid = ezo->reading_valid;
+        reading_ms = ezo->reading_ms;
+        memcpy(&ezo->response[1], ezo->reading, EZO_MAX_RESPONSE_LENGTH);
+    }
+    if (!valid) {
+        ezo_finish(ezo, RET_EZO_NO_RESPONSE);
+    } else if (timer_elapsed_ms(reading_ms) > EZO_UART_MAX_AGE_MS) {
+        ezo_finish(ezo, RET_EZO_TIMEOUT);
+    } else {
+        ezo_finish(ezo, RET_SUCCESS);
+    }
+}
+
+/**
+ * @brief Checks whether the circuit has sent a reading after @p since_ms.
+ */
+static uint8_t ezo_uart_reading_since(ezo_t *ezo, uint32_t since_ms) {
+    uint8_t valid;
+    uint32_t reading_ms;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        valid = ezo->reading_valid;
+        reading_ms = ezo->reading_ms;
+    }
+    return valid && (int32_t)(reading_ms - since_ms) > 0;
+}
+
+/**
+ * @brief Processes the queued commands of a circuit in UART mode.
+ */
+static void ezo_uart_poll(ezo_t *ezo, task_t *task) {
+    ezo_command_t *command = &ezo->queue[ezo->head];
+    uint8_t code, compensated;
+    switch (ezo->state) {
+        case EZO_IDLE:
+            if (ezo->count == 0) {
+                scheduler_suspend(task);
+                return;
+            }
+            if (ezo->continuous && strcmp(command->command, "R") == 0) {
+                ezo_uart_finish_reading(ezo);
+                return;
+            }
+            serial_debug(ezo->source, "Writing command: %s",
+                         command->command);
+            ezo->polls = 0;
+            ezo->response[1] = '\0';
+            ezo->response_code = 0;
+            ezo->state = EZO_WAITING;
+            ezo->command_ms = timer_now_ms();
+            ezo_uart_puts(ezo->uart_id, command->command);
+            ezo_uart_puts(ezo->uart_id, "\r");
+            scheduler_sleep(task, EZO_POLL_INTERVAL_MS);
+            break;
+        default:
+            code = ezo->response_code;
+            compensated = strncmp(command->command, "RT,", 3) == 0;
+            // the slot may still hold a reading from before the command
+            if (code == RESPONSE_SUCCESS && compensated &&
+                ezo_uart_reading_since(ezo, ezo->command_ms)) {
+                ezo_uart_finish_reading(ezo);
+            } else if (code == RESPONSE_SUCCESS && !compensated) {
+                ezo_finish(ezo, RET_SUCCESS);
+            } else if (code == RESPONSE_SYNTAX_ERROR) {
+                ezo_finish(ezo, RET_EZO_SYNTAX_ERR);
+            } else if (++ezo->polls >
+                       command->wait_ms / EZO_POLL_INTERVAL_MS +
+                           EZO_MAX_POLLS) {
+                ezo_finish(ezo, RET_EZO_TIMEOUT);
+            } else {
+                scheduler_sleep(task, EZO_POLL_INTERVAL_MS);
+            }
+            break;
+    }
+}
+
+static void ezo_poll(task_t *task) {
+    ezo_t *ezo = (ezo_t *)((uint8_t *)task - offsetof(ezo_t, task));
+    ezo_command_t *command = &ezo->queue[ezo->head];
+    if (ezo->uart_id) {
+        ezo_uart_poll(ezo, task);
+        return;
+    }
+    switch (ezo->state) {
+        case EZO_IDLE:
+            if (ezo->count == 0) {
+                scheduler_suspend(task);
+                return;
+            }
+            serial_debug(ezo->source, "Writing command: %s",
+                         command->command);
+            ezo->state = EZO_WRITING;
+            ezo->polls = 0;
+            ezo_start_transfer(ezo);
+            break;
+        case EZO_WRITING:
+            if (ezo->transaction.status == RET_TWI_BUSY) {
+                scheduler_suspend(task);
+                return;
+            }
+            if (ezo->transaction.status != RET_SUCCESS) {
+                ezo_finish(ezo, ezo->transaction.status);
+                return;
+            }
+            ezo->state = EZO_WAITING;
+            scheduler_sleep(task, command->wait_ms);
+            break;
+        case EZO_WAITING:
+            ezo->state = EZO_READING;
+            ezo_start_transfer(ezo);
+            break;
+        case EZO_READING:
+            if (ezo->transaction.status == RET_TWI_BUSY) {
+                scheduler_suspend(task);
+                return;
+            }
+            if (ezo->transaction.status != RET_SUCCESS) {
+                ezo_finish(ezo, ezo->transaction.status);
+                return;
+            }
+            ezo_parse_response(ezo);
+            break;
+    }
+}
+
+/**
+ * @brief Sets up the driver of the circuit at @p address and registers its
+ * task.
+ */
+void ezo_init(ezo_t *ezo, uint8_t address, serial_log_source_t source) {
+    memset(ezo, 0, sizeof(*ezo));
+    ezo->address = address;
+    ezo->source = source;
+    ezo->state = EZO_IDLE;
+    twi_init();
+    twi_register_device(address, TWI_CLOCK_HZ);
+    scheduler_add(&ezo->task, ezo_poll);
+    scheduler_suspend(&ezo->task);
+}
+
+/**
+ * @brief Answers `R` commands from the latest value slot once the circuit has
+ * acknowledged `C,1`. Until then they are written to the circuit.
+ */
+static void ezo_continuous_done(ezo_t *ezo, return_status_t status,
+                                char *data, void *context) {
+    (void)data;
+    (void)context;
+    if (status != RET_SUCCESS) {
+        serial_error(ezo->source,
+                     "Could not enable continuous readings. Exit code: %d",
+                     status);
+        return;
+    }
+    ezo->continuous = true;
+    serial_info(ezo->source, "Continuous readings enabled.");
+}
+
+/**
+ * @brief Sets up the driver of a circuit in UART mode on USART @p uart_id and
+ * switches the circuit to continuous readings.
+ *
+ * @param uart_id 1 to 3. USART0 is the host link.
+ */
+void ezo_init_uart(ezo_t *ezo, uint8_t uart_id, serial_log_source_t source) {
+    if (uart_id == 0 || uart_id >= NO_OF_UARTS) {
+        return;
+    }
+    memset(ezo, 0, sizeof(*ezo));
+    ezo->uart_id = uart_id;
+    ezo->source = source;
+    ezo->state = EZO_IDLE;
+    uart_circuits[uart_id] = ezo;
+    uart_init(uart_id, EZO_UART_BAUD);
+    switch (uart_id) {
+        case 1:
+            uart_1_set_receive_callback(ezo_uart_1_receive);
+            break;
+        case 2:
+            uart_2_set_receive_callback(ezo_uart_2_receive);
+            break;
+        case 3:
+            uart_3_set_receive_callback(ezo_uart_3_receive);
+            break;
+    }
+    scheduler_add(&ezo->task, ezo_poll);
+    scheduler_suspend(&ezo->task);
+    // discard whatever the circuit has received so far
+    ezo_uart_puts(uart_id, "\r");
+    ezo_submit(ezo, "C,1", EZO_WAIT_GENERAL_MS, ezo_continuous_done, NULL);
+}
+
+/**
+ * @brief Queues @p command and returns immediately.
+ *
+ * @param wait_ms Processing time of the command before the response is read.
+ * @param callback Called with the response. May be `NULL`.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_EZO_QUEUE_FULL
+ * - @ref RET_EZO_COMMAND_TOO_LONG
+ */
+return_status_t ezo_submit(ezo_t *ezo, const char *command, uint16_t wait_ms,
+                           ezo_callback_t callback, void *context) {
+    ezo_command_t *entry;
+    if (ezo->count >= EZO_QUEUE_LENGTH) {
+        return RET_EZO_QUEUE_FULL;
+    }
+    if (strlen(command) >= EZO_MAX_COMMAND_LENGTH) {
+        return RET_EZO_COMMAND_TOO_LONG;
+    }
+    entry = &ezo->queue[(ezo->head + ezo->count) % EZO_QUEUE_LENGTH];
+    strcpy(entry->command, command);
+    entry->wait_ms = wait_ms;
+    entry->callback = callback;
+    entry->context = context;
+    ezo->count++;
+    scheduler_resume(&ezo->task);
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Queues a reading that sets the temperature compensation of the
+ * circuit first (`RT,<temperature>`), in one command.
+ *
+ * @param centi_degrees Temperature in 1/100 degree Celsius.
+ * @return Returns one of the exit codes of @ref ezo_submit().
+ */
+return_status_t ezo_read_compensated(ezo_t *ezo, int16_t centi_degrees,
+                                     ezo_callback_t callback, void *context) {
+    char command[EZO_MAX_COMMAND_LENGTH] = "RT,";
+    fixed_format(command + 3, centi_degrees, 2);
+    return ezo_submit(ezo, command, EZO_WAIT_READ_MS, callback, context);
+}
+
+/**
+ * @brief Checks whether commands are queued or in progress.
+ */
+uint8_t ezo_busy(const ezo_t *ezo) { return ezo->count > 0; }
+
+/**
+ * @brief Callback for commands without a response value. Logs @p context,
+ * a message string, on success and the exit code otherwise.
+ */
+void ezo_log_done(ezo_t *ezo, return_status_t status, char *data,
+                  void *context) {
+    (void)data;
+    if (status != RET_SUCCESS) {
+        serial_error(ezo->source, "Command failed. Exit code: %d", status);
+        return;
+    }
+    if (context != NULL) {
+        serial_info(ezo->source, "%s", (const char *)context);
+    }
+}
+
+static void ezo_calibration_finish(ezo_t *ezo, return_status_t status) {
+    ezo_calibration_callback_t callback = ezo->calibration_callback;
+    ezo->calibration = NULL;
+    ezo->calibration_callback = NULL;
+    if (ezo == exporting) {
+        exporting = NULL;
+    }
+    callback(ezo, status);
+}
+
+static void ezo_export_next(ezo_t *ezo, return_status_t status, char *data,
+                            void *context) {
+    uint8_t length;
+    (void)context;
+    if (status == RET_SUCCESS && strcmp(data, "*DONE") != 0) {
+        // keep the terminating zero to separate the strings
+        length = strlen(data) + 1;
+        if (export_length + length > EZO_CALIBRATION_SIZE) {
+            ezo_calibration_finish(ezo, RET_EZO_BUFFER_OVERFLOW);
+            return;
+        }
+        memcpy(&export_buffer[export_length], data, length);
+        export_length += length;
+        status = ezo_submit(ezo, "Export", EZO_WAIT_GENERAL_MS,
+                            ezo_export_next, NULL);
+        if (status != RET_SUCCESS) {
+            ezo_calibration_finish(ezo, status);
+        }
+        return;
+    }
+    if (status != RET_SUCCESS) {
+        ezo_calibration_finish(ezo, status);
+        return;
+    }
+    eeprom_update_block(export_buffer, ezo->calibration->data, export_length);
+    eeprom_update_byte(&ezo->calibration->length, export_length);
+    eeprom_update_byte(&ezo->calibration->magic, EEPROM_MAGIC);
+    serial_info(ezo->source, "Exported calibration of %hu bytes.",
+                export_length);
+    ezo_calibration_finish(ezo, RET_SUCCESS);
+}
+
+/**
+ * @brief Reads the calibration of the circuit into the EEPROM @p cache and
+ * returns immediately.
+ *
+ * The circuit hands out its calibration in several strings, one per
+ * `Export` command, until it answers `*DONE`. The strings are collected in
+ * RAM and only written to @p cache once all of them have been read, so a
+ * failed export keeps the previous calibration.
+ *
+ * @param callback Called once the calibration is in @p cache.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_EZO_BUSY if a transfer of a calibration is already in progress.
+ * - @ref RET_EZO_QUEUE_FULL
+ * - @ref RET_EZO_UNSUPPORTED in UART mode, where the calibration strings can
+ * not be told apart from continuous readings.
+ */
+return_status_t ezo_export_calibration(ezo_t *ezo, ezo_calibration_t *cache,
+                                       ezo_calibration_callback_t callback) {
+    return_status_t status;
+    if (ezo->uart_id) {
+        return RET_EZO_UNSUPPORTED;
+    }
+    // all circuits share the buffer
+    if (ezo->calibration_callback != NULL || exporting != NULL) {
+        return RET_EZO_BUSY;
+    }
+    status = ezo_submit(ezo, "Export", EZO_WAIT_GENERAL_MS, ezo_export_next,
+                        NULL);
+    ASSERT_SUCCESS(status);
+    exporting = ezo;
+    export_length = 0;
+    ezo->calibration = cache;
+    ezo->calibration_callback = callback;
+    return RET_SUCCESS;
+}
+
+static void ezo_import_next(ezo_t *ezo, return_status_t status, char *data,
+                            void *context) {
+    char command[EZO_MAX_COMMAND_LENGTH] = "Import,";
+    uint8_t length = strlen(command);
+    uint8_t offset = ezo->calibration_offset;
+    uint8_t end = eeprom_read_byte(&ezo->calibration->length);
+    (void)data;
+    (void)context;
+    if (status != RET_SUCCESS) {
+        ezo_calibration_finish(ezo, status);
+        return;
+    }
+    if (offset >= end) {
+        // the circuit reboots after the last string
+        serial_info(ezo->source, "Imported calibration.");
+        ezo_calibration_finish(ezo, RET_SUCCESS);
+        return;
+    }
+    while (offset < end && length < EZO_MAX_COMMAND_LENGTH) {
+        command[length] = eeprom_read_byte(&ezo->calibration->data[offset++]);
+        if (command[length++] == '\0') {
+            break;
+        }
+    }
+    if (command[length - 1] != '\0') {
+        ezo_calibration_finish(ezo, RET_EZO_COMMAND_TOO_LONG);
+        return;
+    }
+    ezo->calibration_offset = offset;
+    status = ezo_submit(ezo, command, EZO_WAIT_GENERAL_MS, ezo_import_next,
+                        NULL);
+    if (status != RET_SUCCESS) {
+        ezo_calibration_finish(ezo, status);
+    }
+}
+
+/**
+ * @brief Writes the calibration in the EEPROM @p cache to the circuit, one
+ * `Import` command per string, and returns immediately.
+ *
+ * This is how a replaced probe is provisioned with the last known
+ * calibration.
+ *
+ * @param callback Called once all strings have been imported.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_EZO_BUSY if a transfer of a calibration is already in progress.
+ * - @ref RET_EZO_NO_CALIBRATION if @p cache holds no calibration.
+ */
+return_status_t ezo_import_calibration(ezo_t *ezo, ezo_calibration_t *cache,
+                                       ezo_calibration_callback_t callback) {
+    if (ezo->calibration_callback != NULL) {
+        return RET_EZO_BUSY;
+    }
+    if (eeprom_read_byte(&cache->magic) != EEPROM_MAGIC ||
+        eeprom_read_byte(&cache->length) > EZO_CALIBRATION_SIZE) {
+        return RET_EZO_NO_CALIBRATION;
+    }
+    ezo->calibration = cache;
+    ezo->calibration_callback = callback;
+    ezo->calibration_offset = 0;
+    ezo_import_next(ezo, RET_SUCCESS, NULL, NULL);
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Stores chunk @p chunk of @p n_chunks of a calibration sent by the
+ * host in the EEPROM @p cache. The complete calibration is imported to the
+ * circuit with @ref ezo_import_calibration().
+ *
+ * The chunks have to arrive in order. A chunk 0 starts over.
+ *
+ * @param data Up to #EZO_CALIBRATION_CHUNK_SIZE bytes of the calibration.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_EZO_BUSY if a transfer of a calibration is in progress.
+ * - @ref RET_EZO_CHUNK_SEQUENCE_ERR if a chunk is missing.
+ * - @ref RET_EZO_BUFFER_OVERFLOW if the calibration is too large.
+ * - one of the exit codes of @ref ezo_import_calibration()
+ */
+return_status_t ezo_import_calibration_chunk(
+    ezo_t *ezo, ezo_calibration_t *cache, uint8_t chunk, uint8_t n_chunks,
+    const uint8_t *data, uint8_t length, ezo_calibration_callback_t callback) {
+    uint16_t offset = (uint16_t)chunk * EZO_CALIBRATION_CHUNK_SIZE;
+    if (ezo->calibration_callback != NULL) {
+        return RET_EZO_BUSY;
+    }
+    if (chunk == 0) {
+        ezo->import_chunk = 0;
+    }
+    if (chunk != ezo->import_chunk || chunk >= n_chunks) {
+        ezo->import_chunk = 0;
+        return RET_EZO_CHUNK_SEQUENCE_ERR;
+    }
+    if (length > EZO_CALIBRATION_CHUNK_SIZE ||
+        offset + length > EZO_CALIBRATION_SIZE) {
+        ezo->import_chunk = 0;
+        return RET_EZO_BUFFER_OVERFLOW;
+    }
+    if (chunk == 0) {
+        // invalid until the last chunk has arrived
+        eeprom_update_byte(&cache->magic, 0);
+    }
+    eeprom_update_block(data, &cache->data[offset], length);
+    ezo->import_chunk++;
+    if (ezo->import_chunk < n_chunks) {
+        return RET_SUCCESS;
+    }
+    ezo->import_chunk = 0;
+    eeprom_update_byte(&cache->length, offset + length);
+    eeprom_update_byte(&cache->magic, EEPROM_MAGIC);
+    return ezo_import_calibration(ezo, cache, callback);
+}
+
+/**
+ * @brief Copies chunk @p chunk of the calibration in the EEPROM @p cache to
+ * @p data for the transfer to the host.
+ *
+ * @param data Has to hold #EZO_CALIBRATION_CHUNK_SIZE bytes.
+ * @param[out] n_chunks Number of chunks of the calibration, 0 if @p cache
+ * holds no calibration.
+ * @return uint8_t Length of the chunk.
+ */
+uint8_t ezo_calibration_chunk(const ezo_calibration_t *cache, uint8_t chunk,
+                              uint8_t *data, uint8_t *n_chunks) {
+    uint8_t total = eeprom_read_byte(&cache->length);
+    uint16_t offset = (uint16_t)chunk * EZO_CALIBRATION_CHUNK_SIZE;
+    uint8_t length;
+    *n_chunks = 0;
+    if (eeprom_read_byte(&cache->magic) != EEPROM_MAGIC ||
+        total > EZO_CALIBRATION_SIZE) {
+        return 0;
+    }
+    *n_chunks = (total + EZO_CALIBRATION_CHUNK_SIZE - 1) /
+                EZO_CALIBRATION_CHUNK_SIZE;
+    if (offset >= total) {
+        return 0;
+    }
+    length = total - offset < EZO_CALIBRATION_CHUNK_SIZE
+                 ? total - offset
+                 : EZO_CALIBRATION_CHUNK_SIZE;
+    eeprom_read_block(data, &cache->data[offset], length);
+    return length;
+}
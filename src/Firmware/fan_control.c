@@ -0,0 +1,272 @@
+/**
+ * @file fan_control.c
+ * @brief Local control of the box fans by the LED heatsink temperatures.
+ *
+ * The host downloads a hysteresis table and the ROMs of the LED sensors once.
+ * Both are kept in EEPROM. Every new reading of an LED sensor is evaluated
+ * against the table right away and a change of level ramps the fan channels
+ * to the speed of the new level, so the fans follow the heatsinks within one
+ * conversion time and keep doing so when the host is gone. The host only
+ * supervises the controller.
+ *
+ * The controller does not start measurements itself. It relies on the
+ * background sampling of the temperature module or on measurements requested
+ * by the host.
+ */
+#include "fan_control.h"
+
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "pwm.h"
+#include "scheduler.h"
+#include "serial.h"
+#include "temperature.h"
+#include "timer.h"
+
+#define EEPROM_MAGIC 0xA5
+#define ROM_SIZE 8
+#define NO_LEVEL 0xFF
+#define STALE_CHECK_INTERVAL_MS 5000
+
+static task_t fan_control_task;
+static uint8_t enabled = false;
+static uint16_t channels = 0;
+static fan_control_level_t levels[FAN_CONTROL_MAX_LEVELS];
+static uint8_t n_levels = 0;
+static uint8_t roms[FAN_CONTROL_MAX_SENSORS][ROM_SIZE];
+static uint8_t n_sensors = 0;
+
+/**
+ * @brief Latest reading of each LED sensor. Only sensors in #fresh have been
+ * read since the table was set.
+ */
+static int16_t temperatures[FAN_CONTROL_MAX_SENSORS];
+static uint32_t timestamps[FAN_CONTROL_MAX_SENSORS];
+static uint8_t fresh = 0;
+static uint8_t level = NO_LEVEL;
+static int16_t hottest = 0;
+
+static uint8_t ee_magic EEMEM;
+static uint8_t ee_enabled EEMEM;
+static uint16_t ee_channels EEMEM;
+static uint8_t ee_n_levels EEMEM;
+static fan_control_level_t ee_levels[FAN_CONTROL_MAX_LEVELS] EEMEM;
+static uint8_t ee_n_sensors EEMEM;
+static uint8_t ee_roms[FAN_CONTROL_MAX_SENSORS][ROM_SIZE] EEMEM;
+
+static void fan_control_load() {
+    uint8_t count_levels, count_sensors;
+    if (eeprom_read_byte(&ee_magic) != EEPROM_MAGIC) {
+        return;
+    }
+    count_levels = eeprom_read_byte(&ee_n_levels);
+    count_sensors = eeprom_read_byte(&ee_n_sensors);
+    if (count_levels > FAN_CONTROL_MAX_LEVELS ||
+        count_sensors > FAN_CONTROL_MAX_SENSORS) {
+        return;
+    }
+    eeprom_read_block(levels, ee_levels, sizeof(levels[0]) * count_levels);
+    eeprom_read_block(roms, ee_roms, ROM_SIZE * count_sensors);
+    n_levels = count_levels;
+    n_sensors = count_sensors;
+    channels = eeprom_read_word(&ee_channels);
+    enabled = (eeprom_read_byte(&ee_enabled) == true);
+}
+
+static void fan_control_store() {
+    eeprom_update_block(levels, ee_levels, sizeof(levels[0]) * n_levels);
+    eeprom_update_byte(&ee_n_levels, n_levels);
+    eeprom_update_block(roms, ee_roms, ROM_SIZE * n_sensors);
+    eeprom_update_byte(&ee_n_sensors, n_sensors);
+    eeprom_update_word(&ee_channels, channels);
+    eeprom_update_byte(&ee_enabled, enabled);
+    eeprom_update_byte(&ee_magic, EEPROM_MAGIC);
+}
+
+/**
+ * @brief Ramps the fan channels to the speed of @p new_level.
+ */
+static void fan_control_apply(uint8_t new_level) {
+    if (new_level == level) {
+        return;
+    }
+    level = new_level;
+    for (uint8_t i = 0; i < PWM_MAX_CHANNELS; i++) {
+        if (channels & (1U << i)) {
+            pwm_ramp(i, levels[level].pwm, FAN_CONTROL_RAMP_MS,
+                     PWM_CURVE_LINEAR);
+        }
+    }
+    serial_info(SERIAL_SRC_GENERAL, "Fan level %hu at %d/16 degC.", level,
+                hottest);
+}
+
+/**
+ * @brief Finds the hottest of the recent LED readings.
+ *
+ * @return uint8_t `false` if there is no recent reading.
+ */
+static uint8_t fan_control_hottest(int16_t *temperature) {
+    uint8_t found = false;
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        if (!(fresh & (1 << i))) {
+            continue;
+        }
+        if (timer_elapsed_ms(timestamps[i]) > FAN_CONTROL_MAX_AGE_MS) {
+            fresh &= ~(1 << i);
+            continue;
+        }
+        if (!found || temperatures[i] > *temperature) {
+            *temperature = temperatures[i];
+            found = true;
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Moves through the hysteresis table according to the hottest recent
+ * reading.
+ */
+static void fan_control_evaluate() {
+    uint8_t new_level = level;
+    if (!enabled || n_levels == 0) {
+        return;
+    }
+    if (!fan_control_hottest(&hottest)) {
+        if (level != n_levels - 1) {
+            serial_warning(SERIAL_SRC_GENERAL,
+                           "No recent LED temperature. Running fans at the "
+                           "highest level.");
+        }
+        fan_control_apply(n_levels - 1);
+        return;
+    }
+    if (new_level >= n_levels) {
+        for (new_level = 0; new_level < n_levels - 1; new_level++) {
+            if (hottest <= levels[new_level].high) {
+                break;
+            }
+        }
+    }
+    while (new_level < n_levels - 1 && hottest > levels[new_level].high) {
+        new_level++;
+    }
+    while (new_level > 0 && hottest < levels[new_level].low) {
+        new_level--;
+    }
+    fan_control_apply(new_level);
+}
+
+static void fan_control_on_sample(temperature_sample_t *sample) {
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        if (memcmp(roms[i], sample->device.rom, ROM_SIZE) == 0) {
+            temperatures[i] = (int16_t)sample->device.temperature;
+            timestamps[i] = sample->timestamp_ms;
+            fresh |= (1 << i);
+            fan_control_evaluate();
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Falls back to the highest level when the LED sensors stop delivering
+ * readings.
+ */
+static void fan_control_poll(task_t *task) {
+    fan_control_evaluate();
+    scheduler_sleep(task, STALE_CHECK_INTERVAL_MS);
+}
+
+void fan_control_init() {
+    fan_control_load();
+    temperature_set_listener(fan_control_on_sample);
+    scheduler_add(&fan_control_task, fan_control_poll);
+    // give the sensors time for their first readings
+    scheduler_sleep(&fan_control_task, FAN_CONTROL_MAX_AGE_MS);
+    serial_info(SERIAL_SRC_GENERAL,
+                "Fan control %s with %hu levels and %hu sensors.",
+                enabled ? "enabled" : "disabled", n_levels, n_sensors);
+}
+
+/**
+ * @brief Replaces the hysteresis table and stores it in EEPROM.
+ *
+ * The levels have to be ordered from the coolest to the hottest.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_FAN_CONTROL_TOO_MANY
+ * - @ref RET_FAN_CONTROL_INVALID_LEVEL if a band is empty, a level is below
+ * its predecessor or its speed is above #PWM_MAX_VALUE.
+ */
+return_status_t fan_control_set_levels(const fan_control_level_t *new_levels,
+                                       uint8_t count) {
+    if (count > FAN_CONTROL_MAX_LEVELS) {
+        return RET_FAN_CONTROL_TOO_MANY;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (new_levels[i].low > new_levels[i].high ||
+            new_levels[i].pwm > PWM_MAX_VALUE ||
+            (i > 0 && new_levels[i].low < new_levels[i - 1].low)) {
+            return RET_FAN_CONTROL_INVALID_LEVEL;
+        }
+    }
+    memcpy(levels, new_levels, sizeof(levels[0]) * count);
+    n_levels = count;
+    level = NO_LEVEL;
+    fan_control_store();
+    fan_control_evaluate();
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Replaces the list of LED sensors and stores it in EEPROM.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_FAN_CONTROL_TOO_MANY
+ */
+return_status_t fan_control_set_sensors(const uint8_t (*new_roms)[8],
+                                        uint8_t count) {
+    if (count > FAN_CONTROL_MAX_SENSORS) {
+        return RET_FAN_CONTROL_TOO_MANY;
+    }
+    memcpy(roms, new_roms, ROM_SIZE * count);
+    n_sensors = count;
+    fresh = 0;
+    fan_control_store();
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Enables or disables the controller and stores the setting in EEPROM.
+ *
+ * @param fan_channels Mask of the PWM channels of the fans.
+ */
+void fan_control_enable(uint8_t enable, uint16_t fan_channels) {
+    enabled = enable;
+    channels = fan_channels;
+    level = NO_LEVEL;
+    fan_control_store();
+    fan_control_evaluate();
+}
+
+/**
+ * @brief Reports the state of the controller to the supervising host.
+ *
+ * @param current_level 255 if no level has been selected yet.
+ * @param temperature Hottest recent LED reading in 1/16 degree Celsius.
+ */
+void fan_control_get_state(uint8_t *is_enabled, uint8_t *current_level,
+                           int16_t *temperature, uint16_t *pwm) {
+    *is_enabled = enabled;
+    *current_level = level;
+    *temperature = hottest;
+    *pwm = level < n_levels ? levels[level].pwm : 0;
+}
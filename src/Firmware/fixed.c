@@ -0,0 +1,99 @@
+/**
+ * @file fixed.c
+ * @brief Conversion between decimal strings and fixed-point integers.
+ *
+ * A fixed-point value is an integer in units of 10^-decimals, e.g. 2534 with
+ * 2 decimals is 25.34. The EZO circuits talk in decimal strings, so readings
+ * and commands are converted here without pulling the floating point
+ * printf/scanf implementations into the firmware.
+ */
+#include "fixed.h"
+
+#include <stdbool.h>
+
+/**
+ * @brief Parses a decimal number like `-12.345` at the start of @p string
+ * into a fixed-point value with @p decimals decimals.
+ *
+ * Parsing stops at the first character that does not belong to the number,
+ * e.g. the comma between the fields of an EZO reading. Surplus decimals are
+ * truncated.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_FIXED_SYNTAX_ERR if the string does not start with a number.
+ * - @ref RET_FIXED_OVERFLOW if the value does not fit into 31 bits.
+ */
+return_status_t fixed_parse(const char *string, uint8_t decimals,
+                            int32_t *value) {
+    uint32_t result = 0;
+    uint8_t negative = false;
+    uint8_t fraction = false;
+    uint8_t digits = 0;
+    if (*string == '-') {
+        negative = true;
+        string++;
+    }
+    for (; *string != '\0'; string++) {
+        if (*string == '.' && !fraction) {
+            fraction = true;
+            continue;
+        }
+        if (*string < '0' || *string > '9') {
+            break;
+        }
+        digits++;
+        if (fraction) {
+            if (decimals == 0) {
+                continue;
+            }
+            decimals--;
+        }
+        if (result > (INT32_MAX - 9) / 10) {
+            return RET_FIXED_OVERFLOW;
+        }
+        result = result * 10 + (*string - '0');
+    }
+    if (digits == 0) {
+        return RET_FIXED_SYNTAX_ERR;
+    }
+    for (; decimals > 0; decimals--) {
+        if (result > INT32_MAX / 10) {
+            return RET_FIXED_OVERFLOW;
+        }
+        result *= 10;
+    }
+    *value = negative ? -(int32_t)result : (int32_t)result;
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Writes the fixed-point @p value with @p decimals decimals as a
+ * decimal string like `-12.34`.
+ *
+ * @param buffer Has to hold #FIXED_MAX_STRING_LENGTH characters.
+ * @return uint8_t Length of the string without the terminating zero.
+ */
+uint8_t fixed_format(char *buffer, int32_t value, uint8_t decimals) {
+    char digits[10];
+    uint8_t n_digits = 0;
+    uint8_t length = 0;
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    if (value < 0) {
+        buffer[length++] = '-';
+    }
+    // at least one digit in front of the decimal point
+    do {
+        digits[n_digits++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0 || n_digits <= decimals);
+    while (n_digits > 0) {
+        if (n_digits == decimals) {
+            buffer[length++] = '.';
+        }
+        buffer[length++] = digits[--n_digits];
+    }
+    buffer[length] = '\0';
+    return length;
+}
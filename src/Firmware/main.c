@@ -4,151 +4,233 @@
 #include <util/delay.h>
 
 #include "cobs.h"
-#include "ec.h"
+#include "compensation.h"
+#include "fan_control.h"
 #include "led.h"
 #include "packet.h"
 #include "packet_handler.h"
-#include "ph.h"
+#include "probe.h"
 #include "pwm.h"
 #include "relays.h"
+#include "scheduler.h"
 #include "serial.h"
+#include "temperature.h"
+#include "timer.h"
 #include "twi.h"
 
 #define LED_PORT PORTK
 
 void init_modules();
 
+static task_t comms_task;
+static owi_bus_t owi_bus;
+static packet_t packet;
+
+static void handle_packet(packet_t *packet) {
+    serial_debug(SERIAL_SRC_GENERAL, "Handling packet with ID: %hu",
+                 packet->id);
+    switch (packet->id) {
+        case PACKET_ID_CMD_OWI_SET_RES:
+            handle_cmd_owi_set_res(packet);
+            break;
+        case PACKET_ID_CMD_OWI_GET_RES:
+            handle_cmd_owi_get_res(packet);
+            break;
+        case PACKET_ID_CMD_OWI_MEASURE:
+            handle_cmd_owi_measure(packet);
+            break;
+        case PACKET_ID_CMD_OWI_SET_SAMPLING:
+            handle_cmd_owi_set_sampling(packet);
+            break;
+        case PACKET_ID_CMD_OWI_SET_ALARM:
+            handle_cmd_owi_set_alarm(packet);
+            break;
+        case PACKET_ID_CMD_OWI_MEASURE_ALARMS:
+            handle_cmd_owi_measure_alarms(packet);
+            break;
+        case PACKET_ID_CMD_OWI_SET_READ_MODE:
+            handle_cmd_owi_set_read_mode(packet);
+            break;
+        case PACKET_ID_CMD_OWI_GET_STATS:
+            handle_cmd_owi_get_stats(packet);
+            break;
+        case PACKET_ID_CMD_OWI_SET_PROFILE:
+            handle_cmd_owi_set_profile(packet);
+            break;
+        case PACKET_ID_CMD_EC_MEASURE:
+            handle_cmd_ec_measure(packet);
+            break;
+        case PACKET_ID_CMD_EC_IMPORT_CALIB:
+            handle_cmd_ec_import_calib(packet);
+            break;
+        case PACKET_ID_CMD_EC_EXPORT_CALIB:
+            handle_cmd_ec_export_calib(packet);
+            break;
+        case PACKET_ID_CMD_EC_CLEAR_CALIB:
+            handle_cmd_ec_clear_calib(packet);
+            break;
+        case PACKET_ID_CMD_EC_CALIB_DRY:
+            handle_cmd_ec_calib_dry(packet);
+            break;
+        case PACKET_ID_CMD_EC_CALIB_LOW:
+            handle_cmd_ec_calib_low(packet);
+            break;
+        case PACKET_ID_CMD_EC_CALIB_HIGH:
+            handle_cmd_ec_calib_high(packet);
+            break;
+        case PACKET_ID_CMD_EC_COMPENSATION:
+            handle_cmd_ec_compensation(packet);
+            break;
+        case PACKET_ID_CMD_WATER_MEASURE:
+            handle_cmd_water_measure(packet);
+            break;
+        case PACKET_ID_CMD_WATER_SET_SENSORS:
+            handle_cmd_water_set_sensors(packet);
+            break;
+        case PACKET_ID_CMD_PROBE_SET_DEVICE:
+            handle_cmd_probe_set_device(packet);
+            break;
+        case PACKET_ID_CMD_PH_MEASURE:
+            handle_cmd_ph_measure(packet);
+            break;
+        case PACKET_ID_CMD_PH_IMPORT_CALIB:
+            handle_cmd_ph_import_calib(packet);
+            break;
+        case PACKET_ID_CMD_PH_EXPORT_CALIB:
+            handle_cmd_ph_export_calib(packet);
+            break;
+        case PACKET_ID_CMD_PH_CLEAR_CALIB:
+            handle_cmd_ph_clear_calib(packet);
+            break;
+        case PACKET_ID_CMD_PH_CALIB_LOW:
+            handle_cmd_ph_calib_low(packet);
+            break;
+        case PACKET_ID_CMD_PH_CALIB_MID:
+            handle_cmd_ph_calib_mid(packet);
+            break;
+        case PACKET_ID_CMD_PH_CALIB_HIGH:
+            handle_cmd_ph_calib_high(packet);
+            break;
+        case PACKET_ID_CMD_PH_COMPENSATION:
+            handle_cmd_ph_compensation(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_SET:
+            handle_cmd_light_set(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_GET:
+            handle_cmd_light_get(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_BLUE_SET:
+            handle_cmd_light_blue_set(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_BLUE_GET:
+            handle_cmd_light_blue_get(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_RED_SET:
+            handle_cmd_light_red_set(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_RED_GET:
+            handle_cmd_light_red_get(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_WHITE_SET:
+            handle_cmd_light_white_set(packet);
+            break;
+        case PACKET_ID_CMD_LIGHT_WHITE_GET:
+            handle_cmd_light_white_get(packet);
+            break;
+        case PACKET_ID_CMD_FAN_SET_SPEED:
+            handle_cmd_fan_set_speed(packet);
+            break;
+        case PACKET_ID_CMD_FAN_SET_SPEEDS:
+            handle_cmd_fan_set_speeds(packet);
+            break;
+        case PACKET_ID_CMD_PWM_RAMP:
+            handle_cmd_pwm_ramp(packet);
+            break;
+        case PACKET_ID_CMD_FAN_CONTROL_SET_LEVELS:
+            handle_cmd_fan_control_set_levels(packet);
+            break;
+        case PACKET_ID_CMD_FAN_CONTROL_SET_SENSORS:
+            handle_cmd_fan_control_set_sensors(packet);
+            break;
+        case PACKET_ID_CMD_FAN_CONTROL_ENABLE:
+            handle_cmd_fan_control_enable(packet);
+            break;
+        case PACKET_ID_CMD_FAN_CONTROL_GET_STATE:
+            handle_cmd_fan_control_get_state(packet);
+            break;
+        case PACKET_ID_CMD_FAN_GET_SPEED:
+            handle_cmd_fan_get_speed(packet);
+            break;
+        case PACKET_ID_READY_REQUEST:
+            // the ready response is sent after every packet anyway
+            break;
+        default:
+            handle_cmd_unknown(packet);
+            break;
+    }
+}
+
+/**
+ * @brief Serves one command per poll.
+ *
+ * Handlers only start slow operations and return, so the host is told that
+ * the next command can be sent right away while sensors are still busy.
+ */
+static void comms_poll(task_t *task) {
+    (void)task;
+    if (serial_poll_packet(&packet) != RET_SUCCESS) {
+        return;
+    }
+    handle_packet(&packet);
+    encode_response_ready_request(&packet);
+    serial_send_packet(&packet);
+}
+
 int main() {
     sei();
 
     init_modules();
     serial_info(SERIAL_SRC_GENERAL, "All modules initialized");
 
-    packet_t packet;
-
-    while (1) {
-        encode_response_ready_request(&packet);
-        serial_send_packet(&packet);
-        serial_read_packet(&packet);
-        serial_debug(SERIAL_SRC_GENERAL, "Handling packet with ID: %hu",
-                     packet.id);
-        switch (packet.id) {
-            case PACKET_ID_CMD_OWI_SET_RES:
-                handle_cmd_owi_set_res(&packet);
-                break;
-            case PACKET_ID_CMD_OWI_GET_RES:
-                handle_cmd_owi_get_res(&packet);
-                break;
-            case PACKET_ID_CMD_OWI_MEASURE:
-                handle_cmd_owi_measure(&packet);
-                break;
-            case PACKET_ID_CMD_EC_MEASURE:
-                handle_cmd_ec_measure(&packet);
-                break;
-            case PACKET_ID_CMD_EC_IMPORT_CALIB:
-                handle_cmd_ec_import_calib(&packet);
-                break;
-            case PACKET_ID_CMD_EC_EXPORT_CALIB:
-                handle_cmd_ec_export_calib(&packet);
-                break;
-            case PACKET_ID_CMD_EC_CLEAR_CALIB:
-                handle_cmd_ec_clear_calib(&packet);
-                break;
-            case PACKET_ID_CMD_EC_CALIB_DRY:
-                handle_cmd_ec_calib_dry(&packet);
-                break;
-            case PACKET_ID_CMD_EC_CALIB_LOW:
-                handle_cmd_ec_calib_low(&packet);
-                break;
-            case PACKET_ID_CMD_EC_CALIB_HIGH:
-                handle_cmd_ec_calib_high(&packet);
-                break;
-            case PACKET_ID_CMD_EC_COMPENSATION:
-                handle_cmd_ec_compensation(&packet);
-                break;
-            case PACKET_ID_CMD_PH_MEASURE:
-                handle_cmd_ph_measure(&packet);
-                break;
-            case PACKET_ID_CMD_PH_IMPORT_CALIB:
-                handle_cmd_ph_import_calib(&packet);
-                break;
-            case PACKET_ID_CMD_PH_EXPORT_CALIB:
-                handle_cmd_ph_export_calib(&packet);
-                break;
-            case PACKET_ID_CMD_PH_CLEAR_CALIB:
-                handle_cmd_ph_clear_calib(&packet);
-                break;
-            case PACKET_ID_CMD_PH_CALIB_LOW:
-                handle_cmd_ph_calib_low(&packet);
-                break;
-            case PACKET_ID_CMD_PH_CALIB_MID:
-                handle_cmd_ph_calib_mid(&packet);
-                break;
-            case PACKET_ID_CMD_PH_CALIB_HIGH:
-                handle_cmd_ph_calib_high(&packet);
-                break;
-            case PACKET_ID_CMD_PH_COMPENSATION:
-                handle_cmd_ph_compensation(&packet);
-                break;
-            case PACKET_ID_CMD_LIGHT_SET:
-                handle_cmd_light_set(&packet);
-                break;
-            case PACKET_ID_CMD_LIGHT_GET:
-                handle_cmd_light_get(&packet);
-            case PACKET_ID_CMD_LIGHT_BLUE_SET:
-                handle_cmd_light_blue_set(&packet);
-                break;
-            case PACKET_ID_CMD_LIGHT_BLUE_GET:
-                handle_cmd_light_blue_get(&packet);
-            case PACKET_ID_CMD_LIGHT_RED_SET:
-                handle_cmd_light_red_set(&packet);
-                break;
-            case PACKET_ID_CMD_LIGHT_RED_GET:
-                handle_cmd_light_red_get(&packet);
-                break;
-            case PACKET_ID_CMD_LIGHT_WHITE_SET:
-                handle_cmd_light_white_set(&packet);
-                break;
-            case PACKET_ID_CMD_LIGHT_WHITE_GET:
-                handle_cmd_light_white_get(&packet);
-                break;
-            case PACKET_ID_CMD_FAN_SET_SPEED:
-                handle_cmd_fan_set_speed(&packet);
-                break;
-            case PACKET_ID_CMD_FAN_GET_SPEED:
-                handle_cmd_fan_get_speed(&packet);
-                break;
-            default:
-                handle_cmd_unknown(&packet);
-                break;
-        }
-    }
+    scheduler_add(&comms_task, comms_poll);
+    encode_response_ready_request(&packet);
+    serial_send_packet(&packet);
+
+    scheduler_run();
 }
 
 void init_modules() {
+    timer_init();
     serial_init();
     serial_info(SERIAL_SRC_GENERAL, "Booting");
 
     twi_init();
-    return_status_t status;
+    twi_transaction_t probe;
     for (uint8_t address = 0; address < 120; address++) {
-        status = twi_start_write(address);
-        if (status == RET_SUCCESS) {
+        twi_transaction_init(&probe, address, NULL, 0, NULL, 0);
+        if (twi_transfer(&probe) == RET_SUCCESS) {
             serial_info(SERIAL_SRC_GENERAL, "Found I2C-device: 0x%02x",
                         address);
         }
-        twi_stop();
     }
 
     serial_info(SERIAL_SRC_GENERAL, "Init led module...");
     led_init();
     led_boot_sequence();
 
-    serial_info(SERIAL_SRC_GENERAL, "Init ec module...");
-    ec_init();
+    serial_info(SERIAL_SRC_GENERAL, "Init probe module...");
+    probe_init();
 
     serial_info(SERIAL_SRC_GENERAL, "Init owi module...");
-    owi_init(&PORTD, PD4);
+    owi_init(&owi_bus);
+#ifdef OWI_BENCHMARK
+    uint16_t write_us, read_us;
+    owi_benchmark(&owi_bus, &write_us, &read_us);
+    serial_info(SERIAL_SRC_OWI, "Byte write: %u us, byte read: %u us",
+                write_us, read_us);
+#endif
+    temperature_init(&owi_bus);
 
     serial_info(SERIAL_SRC_GENERAL, "Init relays module...");
     relays_init();
@@ -156,6 +238,9 @@ void init_modules() {
     serial_info(SERIAL_SRC_GENERAL, "Init pwm module...");
     pwm_init();
 
-    serial_info(SERIAL_SRC_GENERAL, "Init ph module...");
-    ph_init();
+    serial_info(SERIAL_SRC_GENERAL, "Init fan control module...");
+    fan_control_init();
+
+    serial_info(SERIAL_SRC_GENERAL, "Init compensation module...");
+    compensation_init();
 }
@@ -12,42 +12,60 @@
 #include <avr/io.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <util/atomic.h>
 #include <util/delay.h>
 
+#include "owi_uart.h"
+#include "timer.h"
+
 #define OWI_READ_ROM_CMD 0x33
 #define OWI_SEARCH_ROM_CMD 0xF0
+#define OWI_ALARM_SEARCH_CMD 0xEC
 #define OWI_MATCH_ROM_CMD 0x55
 #define OWI_SKIP_ROM_CMD 0xCC
 #define OWI_CONVERT_TEMP_CMD 0x44
 #define OWI_SCRATCHPAD_READ_CMD 0xBE
 #define OWI_SCRATCHPAD_WRITE_CMD 0x4E
 #define OWI_SCRATCHPAD_COPY_CMD 0x48
+#define OWI_RECALL_CMD 0xB8
 
 #define OWI_RES9_BYTE 0x1F
 #define OWI_RES10_BYTE 0x3F
 #define OWI_RES11_BYTE 0x5F
 #define OWI_RES12_BYTE 0x7F
+#define OWI_RES_MASK 0x60
+#define OWI_RES_SHIFT 5
 
 #define CONV_TIME_9_MS 100
 #define CONV_TIME_10_MS 200
 #define CONV_TIME_11_MS 400
 #define CONV_TIME_12_MS 800
 #define CONV_TIME_MAX 800
+#define RECALL_TIME_MAX_MS 10
+
+#define SCRATCHPAD_SIZE 9
+// temperature LSB and MSB, read in OWI_READ_FAST mode
+#define SCRATCHPAD_FAST_SIZE 2
+#define SCRATCHPAD_CONFIG_INDEX 4
+// bits of the configuration register that always read as ones
+#define SCRATCHPAD_CONFIG_ONES 0x1F
+// MATCH ROM command, ROM, READ SCRATCHPAD command, scratchpad
+#define READ_TRANSFER_SIZE (1 + 8 + 1 + SCRATCHPAD_SIZE)
 
-static volatile uint8_t *port;
-static uint8_t pinNumber = 0;
+#define OWI_DDR DDR_REGISTER(OWI_PORT)
+#define OWI_PIN PIN_REGISTER(OWI_PORT)
+#define OWI_INLINE static inline __attribute__((always_inline))
+
+#define BENCHMARK_BYTES 16
 
-static uint8_t rom[8] = {0};
-static uint8_t last_discrepancy;
-static uint8_t last_family_discrepancy;
-static uint8_t last_device_flag;
 static uint8_t crc8;
 
 /**
- * @brief Holds the resolution set by @ref owi_set_resolution_all.
+ * @brief Holds the slowest resolution of the devices on the bus as far as it
+ * is known, see @ref owi_get_resolution_all().
  *
  */
-static owi_resolution_t resolution_all = OWI_RES_9;
+static owi_resolution_t resolution_all = OWI_RES_12;
 
 /**
  * @brief Lookup table for Maxim Integrated's OWI CRC.
@@ -84,6 +102,272 @@ static uint8_t do_crc8(uint8_t value) {
     return crc8;
 }
 
+/**
+ * @brief Checks the CRC of a complete scratchpad.
+ *
+ * A line stuck at low reads as zeros, which have a valid CRC. Such a
+ * scratchpad is rejected by the configuration register, whose lower bits
+ * always read as ones.
+ *
+ * @return uint8_t true if the scratchpad has been transmitted correctly.
+ */
+static uint8_t owi_scratchpad_valid(const uint8_t *scratchpad) {
+    crc8 = 0;
+    for (uint8_t i = 0; i < SCRATCHPAD_SIZE; i++) {
+        do_crc8(scratchpad[i]);
+    }
+    return crc8 == 0 &&
+           (scratchpad[SCRATCHPAD_CONFIG_INDEX] & SCRATCHPAD_CONFIG_ONES) ==
+               SCRATCHPAD_CONFIG_ONES;
+}
+
+#ifdef OWI_UART
+
+#if OWI_PINS & (OWI_PINS - 1)
+#error "The UART backend drives a single OWI line"
+#endif
+
+/**
+ * @brief Buffer of the non-blocking scratchpad read, see @ref
+ * owi_read_temperatures_start().
+ */
+static uint8_t read_transfer[READ_TRANSFER_SIZE];
+
+/**
+ * @brief Number of scratchpad bytes in #read_transfer.
+ */
+static uint8_t read_length;
+
+/**
+ * @brief Pin number of the single line in @p pins.
+ */
+static uint8_t owi_line_index(uint8_t pins) {
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        if (pins & (1 << line)) {
+            return line;
+        }
+    }
+    return 0;
+}
+
+static uint8_t owi_reset_pins(owi_bus_t *bus, uint8_t pins) {
+    bus->conversion_pollable = false;
+    if (!pins) {
+        return 0;
+    }
+    return owi_uart_reset() ? pins : 0;
+}
+
+static void owi_write_slot(uint8_t pins, uint8_t ones) {
+    uint8_t bit = (ones & pins) ? 0x01 : 0x00;
+    if (pins) {
+        owi_uart_transfer(&bit, NULL, 1);
+    }
+}
+
+static uint8_t owi_read_slot(uint8_t pins) {
+    uint8_t bit = 0x01;
+    if (!pins) {
+        return 0;
+    }
+    owi_uart_transfer(&bit, &bit, 1);
+    return bit ? pins : 0;
+}
+
+static void owi_write_byte_pins(uint8_t pins, uint8_t byte) {
+    if (pins) {
+        owi_uart_transfer(&byte, NULL, 8);
+    }
+}
+
+static void owi_write_bytes_pins(uint8_t pins, const uint8_t *bytes) {
+    if (pins) {
+        owi_uart_transfer(&bytes[owi_line_index(pins)], NULL, 8);
+    }
+}
+
+static void owi_read_bytes_pins(uint8_t pins, uint8_t *bytes) {
+    uint8_t byte = 0xFF;
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        bytes[line] = 0;
+    }
+    if (pins) {
+        owi_uart_transfer(&byte, &byte, 8);
+        bytes[owi_line_index(pins)] = byte;
+    }
+}
+
+#else
+
+/**
+ * @brief Generates a reset pulse on the lines in @p pins.
+ *
+ * The slot primitives are always inlined so that calls with a constant @p
+ * pins compile to single bit instructions on #OWI_PORT.
+ *
+ * @return uint8_t Mask of the lines that answered with a presence pulse.
+ */
+OWI_INLINE uint8_t _owi_reset(uint8_t pins) {
+    uint8_t response = 0;
+    OWI_PORT &= ~pins;  // set output to 0 for reset pulse
+    OWI_DDR |= pins;    // set the pins for 1-wire as output
+    _delay_us(500);
+    // an ISR between release and sampling would make us miss the presence
+    // pulse
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        OWI_DDR &= ~pins;  // set pins to input to read the presence pulse
+        OWI_PORT |= pins;
+        _delay_us(70);  // wait for presence pulse
+        response = OWI_PIN & pins;
+    }
+    _delay_us(200);
+    OWI_PORT |= pins;
+    OWI_DDR |= pins;
+    _delay_us(600);
+    return ~response & pins;
+}
+
+/**
+ * @brief Generates one write slot on the lines in @p pins.
+ *
+ * All lines are pulled low together. The lines in @p ones are released early
+ * to write a logical 1, the others are held low for the whole slot to write a
+ * logical 0.
+ */
+OWI_INLINE void _owi_write_slot(uint8_t pins, uint8_t ones) {
+    // slots are only a few microseconds long and must not be stretched by
+    // the timer or UART interrupts
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        OWI_PORT |= pins;   // set pins high
+        OWI_DDR |= pins;    // set pins as output
+        OWI_PORT &= ~pins;  // set output low to start write slot
+        _delay_us(8);
+        OWI_DDR &= ~ones;  // release the lines writing a 1
+        OWI_PORT |= ones;
+        _delay_us(72);
+        OWI_DDR &= ~pins;  // release the lines writing a 0
+        OWI_PORT |= pins;
+    }
+    _delay_us(2);
+}
+
+/**
+ * @brief Generates one read slot on the lines in @p pins.
+ *
+ * @return uint8_t Mask of the lines that signaled a logical 1.
+ */
+OWI_INLINE uint8_t _owi_read_slot(uint8_t pins) {
+    uint8_t bits = 0;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        OWI_PORT |= pins;   // set pins high
+        OWI_DDR |= pins;    // configure pins as output
+        OWI_PORT &= ~pins;  // start read slot by pulling low
+        _delay_us(2);
+        OWI_DDR &= ~pins;  // release the bus by setting pins as input
+        OWI_PORT |= pins;
+        _delay_us(5);
+        bits = OWI_PIN & pins;  // read the input
+    }
+    _delay_us(60);
+    return bits;
+}
+
+/**
+ * @brief Resets the lines in @p pins.
+ *
+ * Read slot polling of a conversion is only valid as long as no other bus
+ * traffic happened after the convert command, so any reset clears
+ * owi_bus_s::conversion_pollable and only the deadline remains.
+ *
+ * @return uint8_t Mask of the lines that answered with a presence pulse.
+ */
+static uint8_t owi_reset_pins(owi_bus_t *bus, uint8_t pins) {
+    bus->conversion_pollable = false;
+    if (pins == OWI_PINS) {
+        return _owi_reset(OWI_PINS);
+    }
+    return _owi_reset(pins);
+}
+
+/**
+ * @brief Generates one write slot, specialized for writing the same bit to
+ * all of #OWI_PINS.
+ *
+ * Other combinations, which only occur while addressing different devices on
+ * several lines, still use the constant port address but read the masks
+ * from registers.
+ */
+static void owi_write_slot(uint8_t pins, uint8_t ones) {
+    ones &= pins;
+    if (pins == OWI_PINS && ones == OWI_PINS) {
+        _owi_write_slot(OWI_PINS, OWI_PINS);
+    } else if (pins == OWI_PINS && ones == 0) {
+        _owi_write_slot(OWI_PINS, 0);
+    } else {
+        _owi_write_slot(pins, ones);
+    }
+}
+
+/**
+ * @brief Generates one read slot, specialized for reading all of #OWI_PINS.
+ */
+static uint8_t owi_read_slot(uint8_t pins) {
+    if (pins == OWI_PINS) {
+        return _owi_read_slot(OWI_PINS);
+    }
+    return _owi_read_slot(pins);
+}
+
+/**
+ * @brief Writes the same byte to all lines in @p pins.
+ */
+static void owi_write_byte_pins(uint8_t pins, uint8_t byte) {
+    for (uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+        owi_write_slot(pins, (byte & mask) ? pins : 0);
+    }
+}
+
+/**
+ * @brief Writes a different byte to each line in @p pins.
+ *
+ * @param bytes Byte for each line, indexed by the pin number of the line.
+ */
+static void owi_write_bytes_pins(uint8_t pins, const uint8_t *bytes) {
+    uint8_t ones;
+    for (uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+        ones = 0;
+        for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+            if (bytes[line] & mask) {
+                ones |= (1 << line);
+            }
+        }
+        owi_write_slot(pins, ones);
+    }
+}
+
+/**
+ * @brief Reads one byte from each line in @p pins.
+ *
+ * @param[out] bytes Byte read from each line, indexed by the pin number of
+ * the line. Entries of lines not in @p pins are set to 0.
+ */
+static void owi_read_bytes_pins(uint8_t pins, uint8_t *bytes) {
+    uint8_t bits;
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        bytes[line] = 0;
+    }
+    for (uint8_t mask = 0x01; mask != 0; mask <<= 1) {
+        bits = owi_read_slot(pins);
+        for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+            if (bits & (1 << line)) {
+                bytes[line] |= mask;
+            }
+        }
+    }
+}
+
+#endif /* OWI_UART */
+
 /**
  * @brief Helper function that initialized communication with
  * #OWI_MATCH_ROM_CMD.
@@ -91,35 +375,163 @@ static uint8_t do_crc8(uint8_t value) {
  * This function should be followed by the actual command that is to be
  * executed.
  *
+ * @return Returns the return value of @ref owi_reset().
+ *
  * @param device Pointer to the OWI device that holds the ROM address. \see
  * #ds18b20_s
  */
-static void owi_match_rom(ds18b20_t *device) {
-    owi_reset();
-    owi_write_byte(OWI_MATCH_ROM_CMD);
+static return_status_t owi_match_rom(owi_bus_t *bus, ds18b20_t *device) {
+    return_status_t status;
+    status = owi_reset(bus);
+    ASSERT_SUCCESS(status);
+    owi_write_byte(bus, OWI_MATCH_ROM_CMD);
     for (uint8_t i = 0; i < 8; i++) {
-        owi_write_byte(device->rom[i]);
+        owi_write_byte(bus, device->rom[i]);
     }
     _delay_us(10);
+    return RET_SUCCESS;
 }
 
 /**
- * @brief Initializes the OWI module.
+ * @brief Takes over the alarm and configuration registers and the resolution
+ * of @p device from a complete @p scratchpad.
+ */
+static void owi_decode_config(ds18b20_t *device, const uint8_t *scratchpad) {
+    uint8_t resolution_bits;
+    device->alarm_high_register = scratchpad[2];
+    device->alarm_low_register = scratchpad[3];
+    device->config_register = scratchpad[SCRATCHPAD_CONFIG_INDEX];
+    resolution_bits =
+        (device->config_register & OWI_RES_MASK) >> OWI_RES_SHIFT;
+    // the resolution enum counts down from 12 bit
+    device->resolution = OWI_RES_9 - resolution_bits;
+}
+
+/**
+ * @brief Converts the raw reading in the first two bytes of @p scratchpad to
+ * the temperature of @p device.
+ */
+static return_status_t owi_decode_temperature(ds18b20_t *device,
+                                              const uint8_t *scratchpad) {
+    device->temperature = scratchpad[0] | (scratchpad[1] << 8);
+
+    // mask out bits that are undefined in certain resolution modes
+    switch (device->resolution) {
+        case OWI_RES_9:
+            device->temperature &= 0xFFF8;
+            break;
+        case OWI_RES_10:
+            device->temperature &= 0xFFFC;
+            break;
+        case OWI_RES_11:
+            device->temperature &= 0xFFFE;
+            break;
+        case OWI_RES_12:
+            break;
+        default:
+            return RET_OWI_UNKNOWN_RES;
+    }
+
+    // sign bit is set
+    if (device->temperature & 0x8000) {
+        // mask out the sign bits
+        device->temperature &= 0x07FF;
+        // twos complement
+        device->temperature = ((~device->temperature) + 1);
+    }
+
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Initializes an OWI bus consisting of all lines in #OWI_PINS.
+ *
+ * The devices reload their configuration from their EEPROM, so each of them
+ * starts with the resolution and alarm band stored by @ref
+ * owi_set_resolution() and @ref owi_set_alarm().
+ *
+ * @param[out] bus Descriptor of the bus.
+ */
+void owi_init(owi_bus_t *bus) {
+    bus->pins = OWI_PINS;
+    bus->last_discrepancy = 0;
+    bus->last_family_discrepancy = 0;
+    bus->last_device_flag = false;
+    bus->conversion_pending = false;
+    bus->conversion_pollable = false;
+    bus->conversion_start_ms = 0;
+    bus->read_pending = false;
+    bus->read_failed = 0;
+    bus->read_retries = 0;
+    bus->read_mode = OWI_READ_VERIFIED;
+    bus->own_stats.reads = 0;
+    bus->own_stats.crc_errors = 0;
+    bus->own_stats.retries = 0;
+    bus->stats = &bus->own_stats;
+#ifdef OWI_UART
+    owi_uart_init();
+#endif
+    owi_recall_all(bus);
+}
+
+/**
+ * @brief Initializes a descriptor for a single line of @p bus.
+ *
+ * Searches have to be run on single lines, because each line has its own set
+ * of devices.
+ *
+ * @param bus The bus the line belongs to.
+ * @param pin_number Pin number of the line.
+ * @param[out] line Descriptor of the line.
+ */
+void owi_line(const owi_bus_t *bus, uint8_t pin_number, owi_bus_t *line) {
+    line->pins = bus->pins & (1 << pin_number);
+    line->last_discrepancy = 0;
+    line->last_family_discrepancy = 0;
+    line->last_device_flag = false;
+    line->conversion_pending = false;
+    line->conversion_pollable = false;
+    line->conversion_start_ms = 0;
+    line->read_pending = false;
+    line->read_failed = 0;
+    line->read_retries = 0;
+    line->read_mode = bus->read_mode;
+    line->stats = bus->stats;
+}
+
+/**
+ * @brief Selects how temperatures are read from the scratchpads, see @ref
+ * owi_read_mode_e.
+ *
+ * Line descriptors created before keep their mode.
+ */
+void owi_set_read_mode(owi_bus_t *bus, owi_read_mode_t mode) {
+    bus->read_mode = mode;
+}
+
+/**
+ * @brief Copies the read counters of @p bus.
+ *
+ * @param[out] stats Counters since startup, including the reads on line
+ * descriptors of the bus.
+ */
+void owi_get_stats(const owi_bus_t *bus, owi_stats_t *stats) {
+    *stats = *bus->stats;
+}
+
+/**
+ * @brief Resets all devices on all lines of the OWI bus.
  *
- * @param owi_port Port of the data GPIO pin used for OWI communication.
- * @param owi_pinNumber Identifies the GPIO pin of the port used for OWI
- * communication.
+ * @return uint8_t Mask of the lines that answered with a presence pulse.
  */
-void owi_init(volatile uint8_t *owi_port, uint8_t owi_pinNumber) {
-    port = owi_port;
-    pinNumber = owi_pinNumber;
-    owi_set_resolution_all(OWI_RES_12);
+uint8_t owi_reset_lines(owi_bus_t *bus) {
+    return owi_reset_pins(bus, bus->pins);
 }
 
 /**
  * @brief Resets all devices on the OWI bus.
  *
- * Holds down the OWI data line to reset all connected devices. Devices will
+ * Holds down the OWI data lines to reset all connected devices. Devices will
  * answer with a presence pulse indicating their existence.
  *
  * @return Returns one of the following exit codes specified by @ref
@@ -127,96 +539,85 @@ void owi_init(volatile uint8_t *owi_port, uint8_t owi_pinNumber) {
  * - @ref RET_SUCCESS indicating that at least one device is available
  * - @ref RET_OWI_NO_PRESENCE indicating that **no** device is available
  */
-return_status_t owi_reset() {
-    uint8_t response = 0;
-    *port &= ~(1 << pinNumber);  // set output to 0 for reset pulse
-    DDR_REGISTER(*port) |=
-        (1 << pinNumber);  // set the pin for 1-wire as output
-    _delay_us(500);
-    DDR_REGISTER(*port) &=
-        ~(1 << pinNumber);  // set pin to input to read the presence pulse
-    *port |= (1 << pinNumber);
-    _delay_us(70);  // wait for presence pulse
-    response = PIN_REGISTER(*port) & (1 << pinNumber);
-    _delay_us(200);
-    *port |= (1 << pinNumber);
-    DDR_REGISTER(*port) |= (1 << pinNumber);
-    _delay_us(600);
-    return response ? RET_OWI_NO_PRESENCE : RET_SUCCESS;
+return_status_t owi_reset(owi_bus_t *bus) {
+    return owi_reset_lines(bus) ? RET_SUCCESS : RET_OWI_NO_PRESENCE;
 }
 
 /**
- * @brief Writes a single bit to the OWI bus.
+ * @brief Writes a single bit to all lines of the OWI bus.
  *
  * @param bit Writes a logical 1 if @p bit evaluates to `true`. Otherwise a
  * logical 0 will be written.
  */
-void owi_write_bit(uint8_t bit) {
-    *port |= (1 << pinNumber);                // set pin high
-    DDR_REGISTER(*port) |= (1 << pinNumber);  // set pin as output
-    *port &= ~(1 << pinNumber);  // set output low to start write slot
-    if (bit) {
-        _delay_us(8);
-    } else {
-        _delay_us(80);
-    }
-    DDR_REGISTER(*port) &=
-        ~(1 << pinNumber);  // set pin as input to release the bus
-    *port |= (1 << pinNumber);
-    if (bit) {
-        _delay_us(80);
-    } else {
-        _delay_us(2);
-    }
+void owi_write_bit(owi_bus_t *bus, uint8_t bit) {
+    owi_write_slot(bus->pins, bit ? bus->pins : 0);
 }
 
 /**
- * @brief Writes Byte by repeatingly calling @ref owi_write_bit().
+ * @brief Writes Byte to all lines of the OWI bus.
  *
  * @param byte The data to write.
  */
-void owi_write_byte(uint8_t byte) {
-    for (uint8_t mask = 0x01; mask != 0; mask <<= 1) {
-        owi_write_bit(byte & mask);
-    }
+void owi_write_byte(owi_bus_t *bus, uint8_t byte) {
+    owi_write_byte_pins(bus->pins, byte);
 }
 
+/**
+ * @brief Writes a different byte to each line of the OWI bus at the same
+ * time.
+ *
+ * @param bytes Byte for each line, indexed by the pin number of the line.
+ * @attention @p bytes needs to hold #OWI_MAX_LINES entries.
+ */
+void owi_write_bytes(owi_bus_t *bus, const uint8_t *bytes) {
+    owi_write_bytes_pins(bus->pins, bytes);
+}
+
+/**
+ * @brief Reads a single bit from each line of the OWI bus.
+ *
+ * @return uint8_t Mask of the lines that signaled a logical 1.
+ */
+uint8_t owi_read_bits(owi_bus_t *bus) { return owi_read_slot(bus->pins); }
+
 /**
  * @brief Reads a single bit from the OWI bus.
  *
- * @return uint8_t Returns 1 if OWI bus signals a logical 1, returns 0
- * otherwise.
+ * @return uint8_t Returns 1 if all lines of the OWI bus signal a logical 1,
+ * returns 0 otherwise.
  */
-uint8_t owi_read_bit() {
-    uint8_t bit = 0;
-    *port |= (1 << pinNumber);                // set pin high
-    DDR_REGISTER(*port) |= (1 << pinNumber);  // configure pin as output
-    *port &= ~(1 << pinNumber);               // start read slot by pulling low
-    _delay_us(2);
-    DDR_REGISTER(*port) &=
-        ~(1 << pinNumber);  // release the bus by setting pin as input
-    *port |= (1 << pinNumber);
-    _delay_us(5);
-    bit = (PIN_REGISTER(*port) & (1 << pinNumber)) ? true
-                                                   : false;  // read the input
-    _delay_us(60);
-    return bit;
+uint8_t owi_read_bit(owi_bus_t *bus) {
+    return owi_read_bits(bus) == bus->pins;
 }
 
 /**
  * @brief Reads a byte from the OWI bus starting with the least-significant bit
  * by repeatingly calling @ref owi_read_bit().
  *
+ * On a bus with multiple lines, the bits of all lines are combined like on a
+ * single wired-AND line.
+ *
  * @return uint8_t Returns the byte read from the OWI bus.
  */
-uint8_t owi_read_byte() {
+uint8_t owi_read_byte(owi_bus_t *bus) {
     uint8_t byte = 0;
     for (uint8_t mask = 0x01; mask != 0; mask <<= 1) {
-        byte |= (owi_read_bit() * mask);
+        byte |= (owi_read_bit(bus) * mask);
     }
     return byte;
 }
 
+/**
+ * @brief Reads one byte from each line of the OWI bus at the same time.
+ *
+ * @param[out] bytes Byte read from each line, indexed by the pin number of
+ * the line.
+ * @attention @p bytes needs to hold #OWI_MAX_LINES entries.
+ */
+void owi_read_bytes(owi_bus_t *bus, uint8_t *bytes) {
+    owi_read_bytes_pins(bus->pins, bytes);
+}
+
 /**
  * @brief Reads a ROM address by performing a complete communication cycle.
  *
@@ -225,11 +626,11 @@ uint8_t owi_read_byte() {
  *
  * @param romBuffer
  */
-void owi_read_rom(uint8_t *romBuffer) {
-    owi_reset();
-    owi_write_byte(OWI_READ_ROM_CMD);
+void owi_read_rom(owi_bus_t *bus, uint8_t *romBuffer) {
+    owi_reset(bus);
+    owi_write_byte(bus, OWI_READ_ROM_CMD);
     for (uint8_t i = 0; i < 8; i++) {
-        romBuffer[i] = owi_read_byte();
+        romBuffer[i] = owi_read_byte(bus);
     }
 }
 
@@ -240,12 +641,12 @@ void owi_read_rom(uint8_t *romBuffer) {
  * @return Returns one of the following exit codes defined in @ref return_status_t
  * - Return value of @ref owi_search().
  */
-return_status_t owi_search_first() {
-    last_discrepancy = 0;
-    last_device_flag = false;
-    last_family_discrepancy = 0;
+return_status_t owi_search_first(owi_bus_t *bus) {
+    bus->last_discrepancy = 0;
+    bus->last_device_flag = false;
+    bus->last_family_discrepancy = 0;
 
-    return owi_search();
+    return owi_search(bus);
 }
 
 /**
@@ -254,24 +655,28 @@ return_status_t owi_search_first() {
  * @return Returns one of the following exit codes defined in @ref return_status_t.
  * - Return value of @ref owi_search()
  */
-return_status_t owi_search_next() { return owi_search(); }
+return_status_t owi_search_next(owi_bus_t *bus) { return owi_search(bus); }
 
 /**
- * @brief Performs a single search cycle.
+ * @brief Performs a single search cycle with the search command @p command.
  *
- * After each call the newly detected ROM address is stored in @ref rom and can
- * be accessed by calling @ref owi_get_buffered_rom().
+ * After each call the newly detected ROM address is stored in owi_bus_s::rom
+ * and can be accessed by calling @ref owi_get_buffered_rom().
+ *
+ * @attention The devices of different lines would collide during the search.
+ * Only use with a descriptor of a single line, see @ref owi_line().
  *
  * @return Returns one of the following exit codes defined in @ref return_status_t
  * - @ref RET_SUCCESS if new device was detected and it's ROM address was
  * stored
- * - @ref RET_OWI_SEARCH_LAST_DEVICE if all devices has been detected already. A
- * new search can be started by calling @ref owi_search_first().
+ * - @ref RET_OWI_SEARCH_LAST_DEVICE if all devices has been detected already
+ * or no device takes part in the search. A new search can be started by
+ * calling @ref owi_search_first().
  * - Return value of @ref owi_reset() if it's call was not successfull.
  * - @ref RET_OWI_CRC_ERR if the CRC checksum of the read address is invalid.
  * - @ref RET_OWI_INVALID_FAMILY_CODE
  */
-return_status_t owi_search() {
+static return_status_t owi_search_command(owi_bus_t *bus, uint8_t command) {
     uint8_t bit_index = 1;  // count bits starting from 1 (!!!)
     uint8_t byte_index = 0;
     uint8_t last_zero = 0;
@@ -283,55 +688,64 @@ return_status_t owi_search() {
 
     crc8 = 0;
 
-    if (!last_device_flag) {
+    if (!bus->last_device_flag) {
         // send reset pulse and make sure, that sensors are available
-        status = owi_reset();
+        status = owi_reset(bus);
         if (!(status == RET_SUCCESS)) {
-            last_discrepancy = 0;
-            last_device_flag = false;
-            last_family_discrepancy = 0;
+            bus->last_discrepancy = 0;
+            bus->last_device_flag = false;
+            bus->last_family_discrepancy = 0;
             return status;
         }
 
         // send search command
-        owi_write_byte(OWI_SEARCH_ROM_CMD);
+        owi_write_byte(bus, command);
 
         do {
-            response_bit = owi_read_bit();
-            inv_response_bit = owi_read_bit();
+            response_bit = owi_read_bit(bus);
+            inv_response_bit = owi_read_bit(bus);
 
             // both bits = 1 means no device is responding
             if ((response_bit == 1) && (inv_response_bit == 1)) {
+                // no device takes part in this search at all, which is
+                // common for the alarm search
+                if (bit_index == 1) {
+                    bus->last_discrepancy = 0;
+                    bus->last_device_flag = false;
+                    bus->last_family_discrepancy = 0;
+                    return RET_OWI_SEARCH_LAST_DEVICE;
+                }
                 break;
             } else {
                 // all devices have the same bit
                 if (response_bit != inv_response_bit)
                     direction = response_bit;
                 else {
-                    if (bit_index < last_discrepancy)
-                        direction = ((rom[byte_index] & byte_mask) > 0);
+                    if (bit_index < bus->last_discrepancy)
+                        direction = ((bus->rom[byte_index] & byte_mask) > 0);
                     else
-                        direction = (bit_index == last_discrepancy);
+                        direction = (bit_index == bus->last_discrepancy);
 
                     if (direction == 0) {
                         last_zero = bit_index;
-                        if (last_zero < 9) last_family_discrepancy = last_zero;
+                        if (last_zero < 9)
+                            bus->last_family_discrepancy = last_zero;
                     }
                 }
 
                 if (direction == 1)
-                    rom[byte_index] |= byte_mask;
+                    bus->rom[byte_index] |= byte_mask;
                 else
-                    rom[byte_index] &= ~byte_mask;
+                    bus->rom[byte_index] &= ~byte_mask;
 
                 // tell the devices the search direction
-                owi_write_bit(direction);
+                owi_write_bit(bus, direction);
 
                 bit_index++;
                 byte_mask <<= 1;
 
                 if (byte_mask == 0) {
-                    do_crc8(rom[byte_index]);
+                    do_crc8(bus->rom[byte_index]);
                     byte_index++;
                     byte_mask = 1;
                 }
@@ -339,9 +753,9 @@ return_status_t owi_search() {
         } while (byte_index < 8);  // rom bytes are 0-7
 
         if (!((bit_index < 65) || (crc8 != 0))) {
-            last_discrepancy = last_zero;
+            bus->last_discrepancy = last_zero;
 
-            if (last_discrepancy == 0) last_device_flag = true;
+            if (bus->last_discrepancy == 0) bus->last_device_flag = true;
 
             status = RET_SUCCESS;
         } else {
@@ -349,18 +763,55 @@ return_status_t owi_search() {
         }
     }
 
-    if (!(status == RET_SUCCESS) || !rom[0]) {
-        if (!rom[0]) {
+    if (!(status == RET_SUCCESS) || !bus->rom[0]) {
+        if (!bus->rom[0]) {
             status = RET_OWI_INVALID_FAMILY_CODE;
         }
-        last_discrepancy = 0;
-        last_device_flag = false;
-        last_family_discrepancy = 0;
+        bus->last_discrepancy = 0;
+        bus->last_device_flag = false;
+        bus->last_family_discrepancy = 0;
     }
 
     return status;
 }
 
+/**
+ * @brief Like @ref owi_search_first(), but only devices whose alarm flag is
+ * set take part in the search.
+ *
+ * A DS18B20 sets its alarm flag after a conversion if the temperature is
+ * above its TH or not above its TL register, see @ref owi_set_alarm().
+ *
+ * @return Returns one of the following exit codes defined in @ref return_status_t
+ * - Return value of @ref owi_search().
+ */
+return_status_t owi_alarm_search_first(owi_bus_t *bus) {
+    bus->last_discrepancy = 0;
+    bus->last_device_flag = false;
+    bus->last_family_discrepancy = 0;
+
+    return owi_search_command(bus, OWI_ALARM_SEARCH_CMD);
+}
+
+/**
+ * @brief Continues the search started by @ref owi_alarm_search_first().
+ *
+ * @return Returns one of the following exit codes defined in @ref return_status_t
+ * - Return value of @ref owi_search().
+ */
+return_status_t owi_alarm_search_next(owi_bus_t *bus) {
+    return owi_search_command(bus, OWI_ALARM_SEARCH_CMD);
+}
+
+/**
+ * @brief Performs a single search cycle with #OWI_SEARCH_ROM_CMD.
+ *
+ * See @ref owi_search_command().
+ */
+return_status_t owi_search(owi_bus_t *bus) {
+    return owi_search_command(bus, OWI_SEARCH_ROM_CMD);
+}
+
 /**
  * @brief Reads the currently buffered ROM address into @p buffer.
  *
@@ -370,13 +821,13 @@ return_status_t owi_search() {
  * \par Example
  * @code{.c}
  * // start a new search and store the first address in the buffer.
- * owi_search_first();
+ * owi_search_first(&line);
  * // store the buffered ROM address in an array.
- * owi_get_buffered_rom(first_rom);
+ * owi_get_buffered_rom(&line, first_rom);
  * // get the next address
- * owi_search_next();
+ * owi_search_next(&line);
  * // store the buffered ROM again.
- * owi_get_buffered_rom(second_rom);
+ * owi_get_buffered_rom(&line, second_rom);
  * @endcode
  *
  * @param[out] buffer
@@ -386,37 +837,40 @@ return_status_t owi_search() {
  * return_status_t.
  * - @ref RET_SUCCESS
  */
-return_status_t owi_get_buffered_rom(uint8_t *buffer) {
+return_status_t owi_get_buffered_rom(owi_bus_t *bus, uint8_t *buffer) {
     for (uint8_t i = 0; i < 8; i++) {
-        buffer[i] = rom[i];
+        buffer[i] = bus->rom[i];
     }
     return RET_SUCCESS;
 }
 
 /**
- * @brief Unused
+ * @brief Checks whether the device with the currently buffered ROM address is
+ * still on the bus by running a single search along its address.
+ *
+ * The search state and the buffered ROM address are restored afterwards.
  *
- * @return uint8_t
+ * @return uint8_t Returns `true` if the device answered.
  */
-uint8_t owi_verify_device() {
+uint8_t owi_verify_device(owi_bus_t *bus) {
     uint8_t rom_copy[8];
     uint8_t ld_copy, lfd_copy, ldf_copy, result;
 
     for (uint8_t i = 0; i < 8; i++) {
-        rom_copy[i] = rom[i];
+        rom_copy[i] = bus->rom[i];
     }
 
-    ld_copy = last_discrepancy;
-    lfd_copy = last_family_discrepancy;
-    ldf_copy = last_device_flag;
+    ld_copy = bus->last_discrepancy;
+    lfd_copy = bus->last_family_discrepancy;
+    ldf_copy = bus->last_device_flag;
 
-    last_discrepancy = 64;
-    last_device_flag = false;
+    bus->last_discrepancy = 64;
+    bus->last_device_flag = false;
 
-    if (owi_search()) {
+    if (owi_search(bus) == RET_SUCCESS) {
         result = true;
         for (uint8_t i = 0; i < 8; i++) {
-            if (rom_copy[i] != rom[i]) {
+            if (rom_copy[i] != bus->rom[i]) {
                 result = false;
                 break;
             }
@@ -427,16 +881,38 @@ uint8_t owi_verify_device() {
         result = false;
 
     for (uint8_t i = 0; i < 8; i++) {
-        rom[i] = rom_copy[i];
+        bus->rom[i] = rom_copy[i];
     }
 
-    last_discrepancy = ld_copy;
-    last_family_discrepancy = lfd_copy;
-    last_device_flag = ldf_copy;
+    bus->last_discrepancy = ld_copy;
+    bus->last_family_discrepancy = lfd_copy;
+    bus->last_device_flag = ldf_copy;
 
     return result;
 }
 
+/**
+ * @brief Checks whether the device with the ROM address @p device_rom is on the
+ * bus.
+ *
+ * See @ref owi_verify_device(). The buffered ROM address is left unchanged.
+ *
+ * @return uint8_t Returns `true` if the device answered.
+ */
+uint8_t owi_verify_rom(owi_bus_t *bus, const uint8_t *device_rom) {
+    uint8_t rom_copy[8];
+    uint8_t result;
+    for (uint8_t i = 0; i < 8; i++) {
+        rom_copy[i] = bus->rom[i];
+        bus->rom[i] = device_rom[i];
+    }
+    result = owi_verify_device(bus);
+    for (uint8_t i = 0; i < 8; i++) {
+        bus->rom[i] = rom_copy[i];
+    }
+    return result;
+}
+
 /**
  * @brief Get a list of all availabe OWI devices.
  *
@@ -452,30 +928,35 @@ uint8_t owi_verify_device() {
  * - Return value of @ref owi_search_first()
  * - Return value of @ref owi_search_next()
  */
-return_status_t owi_get_devices(ds18b20_t *devices, uint8_t array_size,
-                                uint8_t *count) {
+return_status_t owi_get_devices(owi_bus_t *bus, ds18b20_t *devices,
+                                uint8_t array_size, uint8_t *count) {
     return_status_t status;
 
-    status = owi_search_first();
+    status = owi_search_first(bus);
 
     while (*count < array_size) {
         if (status == RET_SUCCESS) {
             for (uint8_t i = 0; i < 8; i++) {
-                devices[*count].rom[i] = rom[i];
+                devices[*count].rom[i] = bus->rom[i];
             }
             devices[*count].available = true;
             (*count)++;
         } else
             break;
 
-        status = owi_search_next();
+        status = owi_search_next(bus);
     }
 
     return RET_SUCCESS;
 }
 
 /**
- * @brief Gets the globally set resolution.
+ * @brief Gets the slowest resolution of the devices on the bus.
+ *
+ * This is the resolution set by @ref owi_set_resolution_all(), raised by
+ * @ref owi_set_resolution() and @ref owi_write_resolution(). It is assumed to
+ * be 12 bit after @ref owi_init(), because the devices restore their own
+ * resolution from their EEPROM.
  *
  * @param[out] resolution Resolution is written to @p resolution.
  * @return Returns one of the following exit codes defined in @ref
@@ -488,162 +969,408 @@ return_status_t owi_get_resolution_all(owi_resolution_t *resolution) {
 }
 
 /**
- * @brief Sets the resolution for all devices on the bus.
+ * @brief Gets the configuration register for @p resolution.
  *
- * Stores the resolution in #resolution_all.
- *
- * @param resolution One of the resolutons available in @ref return_status_t.
  * @return Returns one of the following exit codes defined in @ref
- * owi_return_e.
+ * return_status_t.
  * - @ref RET_SUCCESS
  * - @ref RET_OWI_UNKNOWN_RES
- * - One of the return values of @ref owi_reset()
  */
-return_status_t owi_set_resolution_all(owi_resolution_t resolution) {
-    return_status_t status;
-    uint8_t resolution_byte;
+static return_status_t owi_resolution_register(owi_resolution_t resolution,
+                                               uint8_t *config_register) {
     switch (resolution) {
         case OWI_RES_9:
-            resolution_byte = OWI_RES9_BYTE;
+            *config_register = OWI_RES9_BYTE;
             break;
         case OWI_RES_10:
-            resolution_byte = OWI_RES10_BYTE;
+            *config_register = OWI_RES10_BYTE;
             break;
         case OWI_RES_11:
-            resolution_byte = OWI_RES11_BYTE;
+            *config_register = OWI_RES11_BYTE;
             break;
         case OWI_RES_12:
-            resolution_byte = OWI_RES12_BYTE;
+            *config_register = OWI_RES12_BYTE;
             break;
         default:
             return RET_OWI_UNKNOWN_RES;
     }
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Sets the resolution for all devices on the bus.
+ *
+ * Stores the resolution in #resolution_all. The broadcast also overwrites the
+ * alarm bands in the scratchpads of all devices with a disabled band, so
+ * restore configured bands with @ref owi_set_alarm() afterwards.
+ *
+ * @param resolution One of the resolutons available in @ref return_status_t.
+ * @return Returns one of the following exit codes defined in @ref
+ * owi_return_e.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_UNKNOWN_RES
+ * - One of the return values of @ref owi_reset()
+ */
+return_status_t owi_set_resolution_all(owi_bus_t *bus,
+                                       owi_resolution_t resolution) {
+    return_status_t status;
+    uint8_t resolution_byte;
+
+    status = owi_resolution_register(resolution, &resolution_byte);
+    ASSERT_SUCCESS(status);
     resolution_all = resolution;
 
-    status = owi_reset();
+    status = owi_reset(bus);
     if (!(status == RET_SUCCESS)) {
         return status;
     }
-    owi_write_byte(OWI_SKIP_ROM_CMD);
-    owi_write_byte(OWI_SCRATCHPAD_WRITE_CMD);
-    // first two byte are for temperature alarm -> ignore them
-    owi_write_byte(0);
-    owi_write_byte(0);
-    owi_write_byte(resolution_byte);
+    owi_write_byte(bus, OWI_SKIP_ROM_CMD);
+    owi_write_byte(bus, OWI_SCRATCHPAD_WRITE_CMD);
+    // the alarm registers cannot be skipped, disable the alarm instead of
+    // letting every device above 0 degree Celsius alarm
+    owi_write_byte(bus, (uint8_t)OWI_ALARM_HIGH_OFF);
+    owi_write_byte(bus, (uint8_t)OWI_ALARM_LOW_OFF);
+    owi_write_byte(bus, resolution_byte);
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Reloads the alarm and configuration registers of all devices on the
+ * bus from their EEPROM.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_TIMEOUT if the devices did not finish the recall.
+ * - One of the return values of @ref owi_reset()
+ */
+return_status_t owi_recall_all(owi_bus_t *bus) {
+    return_status_t status;
+    uint32_t deadline;
+
+    status = owi_reset(bus);
+    ASSERT_SUCCESS(status);
+    owi_write_byte(bus, OWI_SKIP_ROM_CMD);
+    owi_write_byte(bus, OWI_RECALL_CMD);
+    resolution_all = OWI_RES_12;
+    // the devices answer read slots with 0 until the recall is done
+    deadline = timer_deadline_ms(RECALL_TIME_MAX_MS);
+    while (!owi_read_bit(bus)) {
+        if (timer_expired(deadline)) {
+            return RET_OWI_TIMEOUT;
+        }
+    }
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Writes the alarm and configuration registers of @p device to its
+ * scratchpad.
+ *
+ * @param copy Also copy the registers to the EEPROM of the device, so they
+ * survive a power cycle. The EEPROM endures a limited number of writes.
+ */
+static return_status_t owi_write_config(owi_bus_t *bus, ds18b20_t *device,
+                                        uint8_t copy) {
+    return_status_t status;
+    status = owi_match_rom(bus, device);
+    ASSERT_SUCCESS(status);
+    owi_write_byte(bus, OWI_SCRATCHPAD_WRITE_CMD);
+    owi_write_byte(bus, device->alarm_high_register);
+    owi_write_byte(bus, device->alarm_low_register);
+    owi_write_byte(bus, device->config_register);
+    // slower resolutions extend the worst case conversion time of the bus
+    if (device->resolution < resolution_all) {
+        resolution_all = device->resolution;
+    }
+    if (!copy) {
+        return RET_SUCCESS;
+    }
+
+    status = owi_match_rom(bus, device);
+    ASSERT_SUCCESS(status);
+    owi_write_byte(bus, OWI_SCRATCHPAD_COPY_CMD);
+    _delay_ms(10);
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Reads the alarm and configuration registers of @p device.
+ *
+ * @param[in, out] device Sensor holding the ROM address. The registers and
+ * the resolution are written to it.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - Return value of @ref owi_read_scratchpad()
+ */
+return_status_t owi_read_config(owi_bus_t *bus, ds18b20_t *device) {
+    uint8_t scratchpad_buffer[SCRATCHPAD_SIZE];
+    return_status_t status;
+
+    status = owi_read_scratchpad(bus, device, scratchpad_buffer);
+    ASSERT_SUCCESS(status);
+    owi_decode_config(device, scratchpad_buffer);
     return RET_SUCCESS;
 }
 
+/**
+ * @brief Sets the resolution of @p device and keeps its alarm band.
+ */
+static return_status_t owi_configure_resolution(owi_bus_t *bus,
+                                                ds18b20_t *device,
+                                                owi_resolution_t resolution,
+                                                uint8_t copy) {
+    return_status_t status;
+    uint8_t config_register;
+
+    status = owi_resolution_register(resolution, &config_register);
+    ASSERT_SUCCESS(status);
+    status = owi_read_config(bus, device);
+    ASSERT_SUCCESS(status);
+    device->config_register = config_register;
+    device->resolution = resolution;
+    return owi_write_config(bus, device, copy);
+}
+
 /**
  * @brief Sets the resolution for a specified device.
  *
+ * The alarm registers of the device are read first and kept. The new
+ * configuration is copied to the EEPROM of the device.
+ *
  * @param device Pointer to @ref ds18b20_t sensor.
  * @param resolution Available resolutions are defined in @ref owi_resolution_e.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_UNKNOWN_RES
+ * - Return value of @ref owi_read_config()
+ * - Return value of @ref owi_reset()
  */
-void owi_set_resolution(ds18b20_t *device, owi_resolution_t resolution) {
+return_status_t owi_set_resolution(owi_bus_t *bus, ds18b20_t *device,
+                                   owi_resolution_t resolution) {
+    return owi_configure_resolution(bus, device, resolution, true);
+}
+
+/**
+ * @brief Changes the resolution of a specified device until its next power
+ * cycle.
+ *
+ * Like @ref owi_set_resolution(), but the EEPROM of the device is not
+ * written, so the resolution can be changed frequently.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_UNKNOWN_RES
+ * - Return value of @ref owi_read_config()
+ * - Return value of @ref owi_reset()
+ */
+return_status_t owi_write_resolution(owi_bus_t *bus, ds18b20_t *device,
+                                     owi_resolution_t resolution) {
+    return owi_configure_resolution(bus, device, resolution, false);
+}
+
+/**
+ * @brief Sets the alarm band of a specified device.
+ *
+ * After each conversion the device sets its alarm flag if the temperature is
+ * above @p high or not above @p low and then takes part in the search started
+ * by @ref owi_alarm_search_first(). The band is stored in the EEPROM of the
+ * device, its resolution is kept.
+ *
+ * @param high Upper limit in degree Celsius. #OWI_ALARM_HIGH_OFF never
+ * triggers.
+ * @param low Lower limit in degree Celsius. #OWI_ALARM_LOW_OFF never
+ * triggers.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - Return value of @ref owi_read_config()
+ * - Return value of @ref owi_reset()
+ */
+return_status_t owi_set_alarm(owi_bus_t *bus, ds18b20_t *device, int8_t high,
+                              int8_t low) {
+    return_status_t status;
+    status = owi_read_config(bus, device);
+    ASSERT_SUCCESS(status);
+    device->alarm_high_register = (uint8_t)high;
+    device->alarm_low_register = (uint8_t)low;
+    return owi_write_config(bus, device, true);
+}
+
+/**
+ * @brief Worst case conversion time for @p resolution.
+ *
+ * @return uint16_t Conversion time in milliseconds.
+ */
+uint16_t owi_conversion_time_ms(owi_resolution_t resolution) {
     switch (resolution) {
         case OWI_RES_9:
-            device->config_register = OWI_RES9_BYTE;
-            break;
+            return CONV_TIME_9_MS;
         case OWI_RES_10:
-            device->config_register = OWI_RES10_BYTE;
-            break;
+            return CONV_TIME_10_MS;
         case OWI_RES_11:
-            device->config_register = OWI_RES11_BYTE;
-            break;
+            return CONV_TIME_11_MS;
         case OWI_RES_12:
-            device->config_register = OWI_RES12_BYTE;
-            break;
-    }
-
-    device->resolution = resolution;
-
-    owi_reset();
-    owi_write_byte(OWI_MATCH_ROM_CMD);
-    for (uint8_t i = 0; i < 8; i++) {
-        owi_write_byte(device->rom[i]);
-    }
-
-    owi_write_byte(OWI_SCRATCHPAD_WRITE_CMD);
-    owi_write_byte(device->alarm_high_register);
-    owi_write_byte(device->alarm_low_register);
-    owi_write_byte(device->config_register);
-
-    owi_reset();
-    owi_write_byte(OWI_MATCH_ROM_CMD);
-    for (uint8_t i = 0; i < 8; i++) {
-        owi_write_byte(device->rom[i]);
+            return CONV_TIME_12_MS;
+        default:
+            return CONV_TIME_MAX;
     }
-
-    owi_write_byte(OWI_SCRATCHPAD_COPY_CMD);
-    _delay_ms(10);
 }
 
 /**
- * @brief Starts a temperature conversion for all devices on the bus.
+ * @brief Starts a temperature conversion for all devices on all lines of the
+ * bus.
  *
- * This function call should be followed by @ref owi_wait_conversion() call
- * before reading the temperature by calling @ref owi_read_temperature().
+ * The function returns right after the convert command. Poll @ref
+ * owi_conversion_done() until it succeeds or call the blocking @ref
+ * owi_wait_conversion() before reading the temperature by calling @ref
+ * owi_read_temperature().
  *
  * @par Example
  * @code{.c}
- * owi_start_conversion();
- * owi_wait_conversion(NULL);
- * owi_read_temperature(ptr_to_device);
+ * owi_start_conversion(&bus);
+ * while (owi_conversion_done(&bus) == RET_OWI_BUSY) {
+ *     do_other_work_without_bus_traffic();
+ * }
+ * owi_read_temperature(&bus, ptr_to_device);
  * @endcode
  *
  * @return Returns one of the following exit codes defined in @ref return_status_t.
  * - @ref RET_SUCCESS
  * - Return value of @ref owi_reset() if an error occured.
  */
-return_status_t owi_start_conversion() {
+return_status_t owi_start_conversion(owi_bus_t *bus) {
     return_status_t status;
-    status = owi_reset();
+    status = owi_reset(bus);
 
     if (!(status == RET_SUCCESS)) {
         return status;
     }
-    owi_write_byte(OWI_SKIP_ROM_CMD);
-    owi_write_byte(OWI_CONVERT_TEMP_CMD);
+    owi_write_byte(bus, OWI_SKIP_ROM_CMD);
+    owi_write_byte(bus, OWI_CONVERT_TEMP_CMD);
+    bus->conversion_start_ms = timer_now_ms();
+    bus->conversion_deadline =
+        timer_deadline_ms(owi_conversion_time_ms(resolution_all));
+    bus->conversion_pending = true;
+    bus->conversion_pollable = true;
     return RET_SUCCESS;
 }
 
 /**
- * @brief Waits for a specified amount of time it takes for a temperature
- * conversion to complete.
+ * @brief Starts a temperature conversion of a single device.
+ *
+ * The other devices keep their last reading, so a device with a low
+ * resolution can be sampled again while the others are still converting.
+ * @ref owi_conversion_done() reports when @p device is done.
  *
- * If @p device is NULL, the time to wait is specified by the most recent
- * call of #owi_set_resolution_all. Otherwise @ref ds18b20_s.resolution
- * referenced by @p device will be used.
+ * @param device Sensor holding the ROM address and its resolution.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - Return value of @ref owi_reset() if an error occured.
+ */
+return_status_t owi_start_conversion_device(owi_bus_t *bus,
+                                            ds18b20_t *device) {
+    return_status_t status;
+    status = owi_match_rom(bus, device);
+    ASSERT_SUCCESS(status);
+    owi_write_byte(bus, OWI_CONVERT_TEMP_CMD);
+    bus->conversion_start_ms = timer_now_ms();
+    bus->conversion_deadline =
+        timer_deadline_ms(owi_conversion_time_ms(device->resolution));
+    bus->conversion_pending = true;
+    bus->conversion_pollable = true;
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Checks without blocking whether the conversion started by @ref
+ * owi_start_conversion() has finished.
  *
- * @param device Pointer to a @ref ds18b20_t sensor.
+ * Externally powered DS18B20s answer read slots with 0 while they are still
+ * converting, so a single read slot on all lines tells when all of them are
+ * done. If other traffic happened on the bus in the meantime, the worst case
+ * conversion time is used instead.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS if the conversion is complete or none was started.
+ * - @ref RET_OWI_BUSY if the devices are still converting.
+ */
+return_status_t owi_conversion_done(owi_bus_t *bus) {
+    if (!bus->conversion_pending) {
+        return RET_SUCCESS;
+    }
+    if (timer_expired(bus->conversion_deadline) ||
+        (bus->conversion_pollable && owi_read_bit(bus))) {
+        bus->conversion_pending = false;
+        bus->conversion_pollable = false;
+        return RET_SUCCESS;
+    }
+    return RET_OWI_BUSY;
+}
+
+/**
+ * @brief Waits until the conversion started by @ref owi_start_conversion() is
+ * complete for @p device.
+ *
+ * Blocks the caller. Prefer polling @ref owi_conversion_done() from a task.
+ *
+ * @param device The sensor that is read next. Its resolution determines the
+ * worst case conversion time, so a fast sensor can be read before the slower
+ * ones are done. `NULL` waits for all devices.
  * @return Returns one of the following exit codes specified in
  * @ref return_status_t.
  * - @ref RET_SUCCESS
- * - @ref RET_OWI_UNKNOWN_RES
  */
-return_status_t owi_wait_conversion(ds18b20_t *device) {
-    owi_resolution_t resolution;
-    if (device == NULL) {
-        resolution = resolution_all;
-    } else {
-        resolution = device->resolution;
+return_status_t owi_wait_conversion(owi_bus_t *bus, ds18b20_t *device) {
+    uint32_t deadline = 0;
+    if (device != NULL) {
+        deadline = bus->conversion_start_ms +
+                   owi_conversion_time_ms(device->resolution);
     }
-    switch (resolution_all) {
-        case OWI_RES_9:
-            _delay_ms(CONV_TIME_9_MS);
-            break;
-        case OWI_RES_10:
-            _delay_ms(CONV_TIME_10_MS);
-            break;
-        case OWI_RES_11:
-            _delay_ms(CONV_TIME_11_MS);
-            break;
-        case OWI_RES_12:
-            _delay_ms(CONV_TIME_12_MS);
+    while (owi_conversion_done(bus) == RET_OWI_BUSY) {
+        if (device != NULL && timer_expired(deadline)) {
             break;
-        default:
-            _delay_ms(CONV_TIME_12_MS);
-            return RET_OWI_UNKNOWN_RES;
+        }
+    }
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Reads the first @p length bytes of the scratchpad of a sensor once.
+ *
+ * A partial read is ended with a reset, otherwise the sensor would keep
+ * driving the line during the next command.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_NO_PRESENCE if no device answered on the bus or the addressed
+ * device did not drive any bit of the read bytes.
+ */
+static return_status_t owi_read_scratchpad_bytes(owi_bus_t *bus,
+                                                 ds18b20_t *device,
+                                                 uint8_t *buffer,
+                                                 uint8_t length) {
+    return_status_t status;
+    uint8_t all_ones = 0xFF;
+    status = owi_match_rom(bus, device);
+    ASSERT_SUCCESS(status);
+    owi_write_byte(bus, OWI_SCRATCHPAD_READ_CMD);
+    for (uint8_t i = 0; i < length; i++) {
+        buffer[i] = owi_read_byte(bus);
+        all_ones &= buffer[i];
+    }
+    if (length < SCRATCHPAD_SIZE) {
+        owi_reset(bus);
+    }
+    // the idle bus reads as ones if the addressed device is gone
+    if (all_ones == 0xFF) {
+        return RET_OWI_NO_PRESENCE;
     }
     return RET_SUCCESS;
 }
@@ -652,59 +1379,326 @@ return_status_t owi_wait_conversion(ds18b20_t *device) {
  * @brief Reads the temperature from the scratchpad memory of the @p device.
  *
  * For example usage of a complete temperature measurement see @ref
- * owi_start_conversion().
+ * owi_start_conversion(). The scratchpad is read as selected by @ref
+ * owi_set_read_mode().
  *
  * @param[in, out] device Pointer to the sensor. The selected resolution is read
  * from it and the temperature is written to it.
  * @return Returns one of the following exit codes defined in @ref return_status_t.
  * - @ref RET_SUCCESS
  * - @ref RET_OWI_UNKNOWN_RES
+ * - @ref RET_OWI_NO_PRESENCE
+ * - Return value of @ref owi_read_scratchpad()
  */
-return_status_t owi_read_temperature(ds18b20_t *device) {
-    uint8_t scratchpad_buffer[9];
+return_status_t owi_read_temperature(owi_bus_t *bus, ds18b20_t *device) {
+    uint8_t scratchpad_buffer[SCRATCHPAD_SIZE];
+    return_status_t status;
 
-    owi_read_scratchpad(device, scratchpad_buffer);
-    device->temperature = scratchpad_buffer[0] | (scratchpad_buffer[1] << 8);
+    if (bus->read_mode == OWI_READ_FAST) {
+        status = owi_read_scratchpad_bytes(bus, device, scratchpad_buffer,
+                                           SCRATCHPAD_FAST_SIZE);
+        ASSERT_SUCCESS(status);
+        bus->stats->reads++;
+    } else {
+        status = owi_read_scratchpad(bus, device, scratchpad_buffer);
+        ASSERT_SUCCESS(status);
+        owi_decode_config(device, scratchpad_buffer);
+    }
+    return owi_decode_temperature(device, scratchpad_buffer);
+}
 
-    // mask out bits that are undefined in certain resolution modes
-    switch (device->resolution) {
-        case OWI_RES_9:
-            device->temperature &= 0xFFF8;
-            break;
-        case OWI_RES_10:
-            device->temperature &= 0xFFFC;
-            break;
-        case OWI_RES_11:
-            device->temperature &= 0xFFFE;
-            break;
-        case OWI_RES_12:
-            break;
-        default:
-            return RET_OWI_UNKNOWN_RES;
+/**
+ * @brief Reads the first @p length scratchpad bytes of one sensor per line in
+ * lockstep.
+ *
+ * @param pins Lines to read, each of them needs a sensor in @p devices.
+ * @param[out] scratchpads Bytes read on each line.
+ * @return uint8_t Mask of the lines in @p pins whose sensor answered.
+ */
+static uint8_t owi_read_scratchpads(owi_bus_t *bus, uint8_t pins,
+                                    ds18b20_t **devices,
+                                    uint8_t scratchpads[][SCRATCHPAD_SIZE],
+                                    uint8_t length) {
+    uint8_t answered;
+    uint8_t bytes[OWI_MAX_LINES];
+    uint8_t all_ones[OWI_MAX_LINES];
+
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        all_ones[line] = 0xFF;
+    }
+    answered = owi_reset_pins(bus, pins);
+    owi_write_byte_pins(pins, OWI_MATCH_ROM_CMD);
+    for (uint8_t i = 0; i < 8; i++) {
+        for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+            bytes[line] = (pins & (1 << line)) ? devices[line]->rom[i] : 0;
+        }
+        owi_write_bytes_pins(pins, bytes);
+    }
+    _delay_us(10);
+    owi_write_byte_pins(pins, OWI_SCRATCHPAD_READ_CMD);
+    for (uint8_t i = 0; i < length; i++) {
+        owi_read_bytes_pins(pins, bytes);
+        for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+            scratchpads[line][i] = bytes[line];
+            all_ones[line] &= bytes[line];
+        }
+    }
+    if (length < SCRATCHPAD_SIZE) {
+        owi_reset_pins(bus, pins);
     }
 
-    // sign bit is set
-    if (device->temperature & 0x8000) {
-        // mask out the sign bits
-        device->temperature &= 0x07FF;
-        // twos complement
-        device->temperature = ((~device->temperature) + 1);
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        // the idle line reads as ones if the addressed device is gone
+        if (all_ones[line] == 0xFF) {
+            answered &= ~(1 << line);
+        }
     }
+    return answered & pins;
+}
 
+/**
+ * @brief Reads one sensor per line of the bus at the same time.
+ *
+ * The MATCH ROM sequence and the scratchpad read run in lockstep on all
+ * lines that have a sensor in @p devices, so reading one sensor on each of
+ * several lines takes as long as reading a single one. In #OWI_READ_VERIFIED
+ * mode only the lines with a CRC error are read again.
+ *
+ * @param[in, out] devices Sensor to read on each line, indexed by the pin
+ * number of the line. Lines with a `NULL` entry stay idle. The temperature is
+ * written to each sensor that has been read.
+ * @attention @p devices needs to hold #OWI_MAX_LINES entries.
+ * @return uint8_t Mask of the lines whose sensor could not be read.
+ */
+uint8_t owi_read_temperatures(owi_bus_t *bus, ds18b20_t **devices) {
+    uint8_t pins = 0;
+    uint8_t failed = 0;
+    uint8_t answered;
+    uint8_t verified = (bus->read_mode == OWI_READ_VERIFIED);
+    uint8_t length = verified ? SCRATCHPAD_SIZE : SCRATCHPAD_FAST_SIZE;
+    uint8_t scratchpads[OWI_MAX_LINES][SCRATCHPAD_SIZE];
+
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        if (devices[line] != NULL) {
+            pins |= (1 << line);
+        }
+    }
+    pins &= bus->pins;
+
+    for (uint8_t attempt = 0; pins; attempt++) {
+        answered =
+            owi_read_scratchpads(bus, pins, devices, scratchpads, length);
+        failed |= pins & ~answered;
+        pins = 0;
+        for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+            if (!(answered & (1 << line))) {
+                continue;
+            }
+            bus->stats->reads++;
+            if (verified && !owi_scratchpad_valid(scratchpads[line])) {
+                bus->stats->crc_errors++;
+                if (attempt < OWI_READ_RETRIES) {
+                    bus->stats->retries++;
+                    pins |= (1 << line);
+                } else {
+                    failed |= (1 << line);
+                }
+                continue;
+            }
+            if (verified) {
+                owi_decode_config(devices[line], scratchpads[line]);
+            }
+            if (owi_decode_temperature(devices[line], scratchpads[line]) !=
+                RET_SUCCESS) {
+                failed |= (1 << line);
+            }
+        }
+    }
+    return failed;
+}
+
+#ifdef OWI_UART
+/**
+ * @brief Starts the transfer of a scratchpad read of @p device in the
+ * background.
+ *
+ * Sets #owi_bus_s::read_failed if the line does not answer the reset.
+ */
+static void owi_read_transfer_start(owi_bus_t *bus, const ds18b20_t *device) {
+    if (!owi_reset_pins(bus, bus->pins)) {
+        bus->read_failed = bus->pins;
+        return;
+    }
+    read_length = (bus->read_mode == OWI_READ_FAST) ? SCRATCHPAD_FAST_SIZE
+                                                     : SCRATCHPAD_SIZE;
+    read_transfer[0] = OWI_MATCH_ROM_CMD;
+    for (uint8_t i = 0; i < 8; i++) {
+        read_transfer[1 + i] = device->rom[i];
+    }
+    read_transfer[9] = OWI_SCRATCHPAD_READ_CMD;
+    for (uint8_t i = 0; i < read_length; i++) {
+        read_transfer[10 + i] = 0xFF;
+    }
+    owi_uart_start(read_transfer, read_transfer,
+                   (READ_TRANSFER_SIZE - SCRATCHPAD_SIZE + read_length) * 8);
+    bus->read_pending = true;
+}
+#endif
+
+/**
+ * @brief Starts reading one sensor per line and returns as soon as possible.
+ *
+ * Non-blocking variant of @ref owi_read_temperatures(). The bit-banged lines
+ * need the CPU for every slot, so they are read right away. The UART backend
+ * runs the transfer from its interrupt and the CPU is free until @ref
+ * owi_read_temperatures_done() reports the result.
+ *
+ * @param devices Sensor to read on each line, see @ref
+ * owi_read_temperatures(). The array has to stay unchanged until the read is
+ * done.
+ */
+void owi_read_temperatures_start(owi_bus_t *bus, ds18b20_t **devices) {
+#ifdef OWI_UART
+    uint8_t line = owi_line_index(bus->pins);
+    bus->read_failed = 0;
+    bus->read_pending = false;
+    bus->read_retries = 0;
+    if (!bus->pins || devices[line] == NULL) {
+        return;
+    }
+    owi_read_transfer_start(bus, devices[line]);
+#else
+    bus->read_failed = owi_read_temperatures(bus, devices);
+#endif
+}
+
+/**
+ * @brief Checks without blocking whether the read started by @ref
+ * owi_read_temperatures_start() has finished.
+ *
+ * A read with a CRC error is started again in the background, so the result
+ * may take several calls longer.
+ *
+ * @param[in, out] devices The same array passed to @ref
+ * owi_read_temperatures_start(). The temperature is written to each sensor
+ * that has been read.
+ * @param[out] failed Mask of the lines whose sensor could not be read.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS if the read is complete and @p failed is set.
+ * - @ref RET_OWI_BUSY
+ */
+return_status_t owi_read_temperatures_done(owi_bus_t *bus, ds18b20_t **devices,
+                                           uint8_t *failed) {
+#ifdef OWI_UART
+    return_status_t status;
+    uint8_t all_ones;
+    uint8_t *scratchpad = &read_transfer[10];
+    ds18b20_t *device = devices[owi_line_index(bus->pins)];
+    while (bus->read_pending) {
+        status = owi_uart_done();
+        if (status == RET_OWI_BUSY) {
+            return status;
+        }
+        bus->read_pending = false;
+        if (read_length < SCRATCHPAD_SIZE) {
+            owi_reset_pins(bus, bus->pins);
+        }
+        all_ones = 0xFF;
+        for (uint8_t i = 0; i < read_length; i++) {
+            all_ones &= scratchpad[i];
+        }
+        if (status != RET_SUCCESS || all_ones == 0xFF) {
+            bus->read_failed = bus->pins;
+            break;
+        }
+        bus->stats->reads++;
+        if (read_length == SCRATCHPAD_SIZE) {
+            if (!owi_scratchpad_valid(scratchpad)) {
+                bus->stats->crc_errors++;
+                if (bus->read_retries < OWI_READ_RETRIES) {
+                    bus->read_retries++;
+                    bus->stats->retries++;
+                    owi_read_transfer_start(bus, device);
+                    continue;
+                }
+                bus->read_failed = bus->pins;
+                break;
+            }
+            owi_decode_config(device, scratchpad);
+        }
+        if (owi_decode_temperature(device, scratchpad) != RET_SUCCESS) {
+            bus->read_failed = bus->pins;
+        }
+    }
+#else
+    // the bit-bang backend reads everything in the start call
+    (void)devices;
+#endif
+    *failed = bus->read_failed;
     return RET_SUCCESS;
 }
 
 /**
- * @brief Reads the scratchpad of a sensor.
+ * @brief Reads the complete scratchpad of a sensor and checks its CRC.
+ *
+ * The scratchpad is read up to #OWI_READ_RETRIES more times if the CRC does
+ * not match.
  *
  * @param[in] device Holding the ROM address of the sensor.
  * @param[out] buffer Pointer to the buffer.
  * @attention Length of @p buffer needs to be at least 9.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_NO_PRESENCE if no device answered on the bus or the addressed
+ * device did not drive any bit of the scratchpad.
+ * - @ref RET_OWI_CRC_ERR if all reads failed the CRC check.
  */
-void owi_read_scratchpad(ds18b20_t *device, uint8_t *buffer) {
-    owi_match_rom(device);
-    owi_write_byte(OWI_SCRATCHPAD_READ_CMD);
-    for (uint8_t i = 0; i < 9; i++) {
-        buffer[i] = owi_read_byte();
+return_status_t owi_read_scratchpad(owi_bus_t *bus, ds18b20_t *device,
+                                   uint8_t *buffer) {
+    return_status_t status;
+    for (uint8_t attempt = 0;; attempt++) {
+        status =
+            owi_read_scratchpad_bytes(bus, device, buffer, SCRATCHPAD_SIZE);
+        ASSERT_SUCCESS(status);
+        bus->stats->reads++;
+        if (owi_scratchpad_valid(buffer)) {
+            return RET_SUCCESS;
+        }
+        bus->stats->crc_errors++;
+        if (attempt >= OWI_READ_RETRIES) {
+            return RET_OWI_CRC_ERR;
+        }
+        bus->stats->retries++;
     }
 }
+
+/**
+ * @brief Measures the average time of a byte write and a byte read on @p bus.
+ *
+ * A byte consists of eight slots with a nominal length of 82 us for writing
+ * and 67 us for reading, everything on top of that is overhead of the
+ * driver. The bus is reset afterwards, because the devices may have
+ * interpreted the written bytes as a command.
+ *
+ * @param[out] write_us Average time of @ref owi_write_byte() in microseconds.
+ * @param[out] read_us Average time of @ref owi_read_byte() in microseconds.
+ */
+void owi_benchmark(owi_bus_t *bus, uint16_t *write_us, uint16_t *read_us) {
+    uint32_t start;
+
+    start = timer_now_us();
+    for (uint8_t i = 0; i < BENCHMARK_BYTES; i++) {
+        owi_write_byte(bus, 0xFF);
+    }
+    *write_us = timer_elapsed_us(start) / BENCHMARK_BYTES;
+
+    start = timer_now_us();
+    for (uint8_t i = 0; i < BENCHMARK_BYTES; i++) {
+        owi_read_byte(bus);
+    }
+    *read_us = timer_elapsed_us(start) / BENCHMARK_BYTES;
+
+    owi_reset(bus);
+}
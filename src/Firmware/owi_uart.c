@@ -0,0 +1,177 @@
+/**
+ * @file owi_uart.c
+ * @brief OWI master on USART1, see owi_uart.h.
+ *
+ * Slots are chained in the receive interrupt: the echo of a slot frame is
+ * sampled and the next frame is written right away, so a transfer of several
+ * bytes runs in the background once it has been started.
+ */
+#include "owi_uart.h"
+
+#ifdef OWI_UART
+
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "timer.h"
+#include "uart.h"
+
+#define OWI_UART_ID 1
+#define RESET_BAUD 9600UL
+#define SLOT_BAUD 115200UL
+#define RESET_FRAME 0xF0
+#define SLOT_ONE 0xFF
+#define SLOT_ZERO 0x00
+// same rounding as uart_init()
+#define BAUD_REGISTER(baud) (F_CPU / (16UL * (baud)) - 1)
+#define RESET_TIMEOUT_MS 3
+// a slot frame takes 80 us, give every 8 slots a millisecond
+#define TRANSFER_TIMEOUT_MS(n_slots) ((n_slots) / 8 + 2)
+
+static const uint8_t *tx_data;
+static uint8_t *rx_data;
+static volatile uint16_t slots_left;
+static uint8_t slot_mask;
+static uint8_t tx_byte;
+static uint8_t rx_byte;
+static volatile uint8_t busy = false;
+static volatile uint8_t resetting = false;
+static volatile uint8_t reset_response;
+static uint32_t deadline;
+
+/**
+ * @brief Samples the echo of the last frame and starts the next slot.
+ *
+ * Called from the USART1 receive interrupt.
+ */
+static void owi_uart_receive(char data) {
+    if (resetting) {
+        reset_response = data;
+        resetting = false;
+        busy = false;
+        return;
+    }
+    if (!busy) {
+        return;
+    }
+    // a device pulling the line low during a slot corrupts the echo
+    if ((uint8_t)data == SLOT_ONE) {
+        rx_byte |= slot_mask;
+    }
+    slot_mask <<= 1;
+    if (--slots_left == 0 || slot_mask == 0) {
+        if (rx_data != NULL) {
+            *rx_data++ = rx_byte;
+        }
+        if (slots_left == 0) {
+            busy = false;
+            return;
+        }
+        tx_byte = *tx_data++;
+        rx_byte = 0;
+        slot_mask = 1;
+    }
+    UDR1 = (tx_byte & slot_mask) ? SLOT_ONE : SLOT_ZERO;
+}
+
+/**
+ * @brief Waits for the reset or transfer in progress.
+ */
+static return_status_t owi_uart_wait() {
+    return_status_t status;
+    while ((status = owi_uart_done()) == RET_OWI_BUSY)
+        ;
+    return status;
+}
+
+void owi_uart_init() {
+    uart_init(OWI_UART_ID, SLOT_BAUD);
+    uart_1_set_receive_callback(owi_uart_receive);
+}
+
+/**
+ * @brief Generates a reset pulse by sending #RESET_FRAME at 9600 baud.
+ *
+ * Presence pulses of the devices overlap the upper bits of the frame, so the
+ * echo differs from the frame if any device is present.
+ *
+ * @return uint8_t `true` if at least one device answered.
+ */
+uint8_t owi_uart_reset() {
+    owi_uart_wait();
+    UBRR1 = BAUD_REGISTER(RESET_BAUD);
+    deadline = timer_deadline_ms(RESET_TIMEOUT_MS);
+    resetting = true;
+    busy = true;
+    UDR1 = RESET_FRAME;
+    if (owi_uart_wait() != RET_SUCCESS) {
+        resetting = false;
+        UBRR1 = BAUD_REGISTER(SLOT_BAUD);
+        return false;
+    }
+    UBRR1 = BAUD_REGISTER(SLOT_BAUD);
+    return reset_response != RESET_FRAME;
+}
+
+/**
+ * @brief Starts a transfer of @p n_slots slots and returns immediately.
+ *
+ * Slot i writes bit (i % 8) of `tx[i / 8]`, least significant bit first.
+ * Reading is done by writing ones, which the devices may pull down. The bits
+ * seen on the line are stored in @p rx the same way. @p rx may be the same
+ * buffer as @p tx or `NULL` if nothing is to be read. Both buffers have to
+ * stay valid until @ref owi_uart_done() reports the end of the transfer.
+ */
+void owi_uart_start(const uint8_t *tx, uint8_t *rx, uint16_t n_slots) {
+    owi_uart_wait();
+    if (!n_slots) {
+        return;
+    }
+    tx_data = tx;
+    rx_data = rx;
+    tx_byte = *tx_data++;
+    rx_byte = 0;
+    slot_mask = 1;
+    slots_left = n_slots;
+    deadline = timer_deadline_ms(TRANSFER_TIMEOUT_MS(n_slots));
+    busy = true;
+    UDR1 = (tx_byte & slot_mask) ? SLOT_ONE : SLOT_ZERO;
+}
+
+/**
+ * @brief Checks without blocking whether the reset or transfer in progress
+ * has finished.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_BUSY
+ * - @ref RET_OWI_TIMEOUT if the USART did not receive the echo of a frame.
+ * The transfer is aborted.
+ */
+return_status_t owi_uart_done() {
+    if (!busy) {
+        return RET_SUCCESS;
+    }
+    if (timer_expired(deadline)) {
+        busy = false;
+        return RET_OWI_TIMEOUT;
+    }
+    return RET_OWI_BUSY;
+}
+
+/**
+ * @brief Blocking version of @ref owi_uart_start().
+ *
+ * Interrupts stay enabled during the whole transfer.
+ *
+ * @return Returns the return value of @ref owi_uart_done().
+ */
+return_status_t owi_uart_transfer(const uint8_t *tx, uint8_t *rx,
+                                  uint16_t n_slots) {
+    owi_uart_start(tx, rx, n_slots);
+    return owi_uart_wait();
+}
+
+#endif /* OWI_UART */
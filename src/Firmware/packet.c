@@ -57,23 +57,30 @@ void encode_cmd_owi_measure(packet_t *packet) {
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_data_owi(packet_t *packet, uint8_t *rom, uint16_t temperature) {
+void encode_data_owi(packet_t *packet, uint8_t *rom, uint16_t temperature,
+                     uint16_t age_ms) {
     packet->id = PACKET_ID_DATA_OWI;
     for (uint8_t i = 0; i < OWI_ROM_SIZE; i++) {
         packet->payload[i] = rom[i];
     }
     packet->payload[OWI_ROM_SIZE] = (uint8_t)(temperature & 0xFF);
     packet->payload[OWI_ROM_SIZE + 1] = (uint8_t)((temperature >> 8) & 0xFF);
-    packet->payload_length = OWI_ROM_SIZE + sizeof(temperature);
+    packet->payload[OWI_ROM_SIZE + 2] = (uint8_t)(age_ms & 0xFF);
+    packet->payload[OWI_ROM_SIZE + 3] = (uint8_t)((age_ms >> 8) & 0xFF);
+    packet->payload_length =
+        OWI_ROM_SIZE + sizeof(temperature) + sizeof(age_ms);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void decode_data_owi(packet_t *packet, uint8_t *rom, uint16_t *temperature) {
+void decode_data_owi(packet_t *packet, uint8_t *rom, uint16_t *temperature,
+                     uint16_t *age_ms) {
     for (uint8_t i = 0; i < OWI_ROM_SIZE; i++) {
         rom[i] = packet->payload[i];
     }
     *temperature = (uint16_t)packet->payload[OWI_ROM_SIZE] |
                    (packet->payload[OWI_ROM_SIZE + 1] << 8);
+    *age_ms = (uint16_t)packet->payload[OWI_ROM_SIZE + 2] |
+              (packet->payload[OWI_ROM_SIZE + 3] << 8);
 }
 
 void encode_response_owi_get_res(packet_t *packet, uint8_t res) {
@@ -87,80 +94,328 @@ void decode_response_owi_get_res(packet_t *packet, uint8_t *res) {
     *res = packet->payload[0];
 }
 
-void encode_cmd_ec_measure(packet_t *packet) {
-    packet->id = PACKET_ID_CMD_EC_MEASURE;
+void encode_cmd_owi_set_sampling(packet_t *packet, uint32_t period_ms,
+                                 uint32_t max_age_ms) {
+    packet->id = PACKET_ID_CMD_OWI_SET_SAMPLING;
+    for (uint8_t i = 0; i < sizeof(period_ms); i++) {
+        packet->payload[i] = (uint8_t)((period_ms >> (8 * i)) & 0xFF);
+        packet->payload[sizeof(period_ms) + i] =
+            (uint8_t)((max_age_ms >> (8 * i)) & 0xFF);
+    }
+    packet->payload_length = sizeof(period_ms) + sizeof(max_age_ms);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_owi_set_sampling(packet_t *packet, uint32_t *period_ms,
+                                 uint32_t *max_age_ms) {
+    *period_ms = 0;
+    *max_age_ms = 0;
+    for (uint8_t i = 0; i < sizeof(*period_ms); i++) {
+        *period_ms |= (uint32_t)packet->payload[i] << (8 * i);
+        *max_age_ms |= (uint32_t)packet->payload[sizeof(*period_ms) + i]
+                       << (8 * i);
+    }
+}
+
+void encode_cmd_owi_set_alarm(packet_t *packet, uint8_t *rom, int8_t high,
+                              int8_t low) {
+    packet->id = PACKET_ID_CMD_OWI_SET_ALARM;
+    for (uint8_t i = 0; i < OWI_ROM_SIZE; i++) {
+        packet->payload[i] = rom[i];
+    }
+    packet->payload[OWI_ROM_SIZE] = (uint8_t)high;
+    packet->payload[OWI_ROM_SIZE + 1] = (uint8_t)low;
+    packet->payload_length = OWI_ROM_SIZE + sizeof(high) + sizeof(low);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_owi_set_alarm(packet_t *packet, uint8_t *rom, int8_t *high,
+                              int8_t *low) {
+    for (uint8_t i = 0; i < OWI_ROM_SIZE; i++) {
+        rom[i] = packet->payload[i];
+    }
+    *high = (int8_t)packet->payload[OWI_ROM_SIZE];
+    *low = (int8_t)packet->payload[OWI_ROM_SIZE + 1];
+}
+
+void encode_cmd_owi_measure_alarms(packet_t *packet) {
+    packet->id = PACKET_ID_CMD_OWI_MEASURE_ALARMS;
     packet->payload_length = 0;
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_import_calib(packet_t *packet, uint8_t *data,
-                                uint8_t length) {
+void encode_response_owi_measure_alarms(packet_t *packet, uint8_t n_alarms) {
+    packet->id = PACKET_ID_RESPONSE_OWI_MEASURE_ALARMS;
+    packet->payload[0] = n_alarms;
+    packet->payload_length = sizeof(n_alarms);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_response_owi_measure_alarms(packet_t *packet, uint8_t *n_alarms) {
+    *n_alarms = packet->payload[0];
+}
+
+void encode_cmd_owi_set_read_mode(packet_t *packet, uint8_t mode) {
+    packet->id = PACKET_ID_CMD_OWI_SET_READ_MODE;
+    packet->payload[0] = mode;
+    packet->payload_length = sizeof(mode);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_owi_set_read_mode(packet_t *packet, uint8_t *mode) {
+    *mode = packet->payload[0];
+}
+
+void encode_cmd_owi_get_stats(packet_t *packet) {
+    packet->id = PACKET_ID_CMD_OWI_GET_STATS;
+    packet->payload_length = 0;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void encode_cmd_owi_set_profile(packet_t *packet, uint8_t *rom, uint8_t res,
+                                uint8_t adaptive) {
+    packet->id = PACKET_ID_CMD_OWI_SET_PROFILE;
+    for (uint8_t i = 0; i < OWI_ROM_SIZE; i++) {
+        packet->payload[i] = rom[i];
+    }
+    packet->payload[OWI_ROM_SIZE] = res;
+    packet->payload[OWI_ROM_SIZE + 1] = adaptive;
+    packet->payload_length = OWI_ROM_SIZE + sizeof(res) + sizeof(adaptive);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_owi_set_profile(packet_t *packet, uint8_t *rom, uint8_t *res,
+                                uint8_t *adaptive) {
+    for (uint8_t i = 0; i < OWI_ROM_SIZE; i++) {
+        rom[i] = packet->payload[i];
+    }
+    *res = packet->payload[OWI_ROM_SIZE];
+    *adaptive = packet->payload[OWI_ROM_SIZE + 1];
+}
+
+void encode_response_owi_get_stats(packet_t *packet, uint8_t mode,
+                                   uint16_t reads, uint16_t crc_errors,
+                                   uint16_t retries) {
+    packet->id = PACKET_ID_RESPONSE_OWI_GET_STATS;
+    packet->payload[0] = mode;
+    packet->payload[1] = reads & 0xFF;
+    packet->payload[2] = (reads >> 8) & 0xFF;
+    packet->payload[3] = crc_errors & 0xFF;
+    packet->payload[4] = (crc_errors >> 8) & 0xFF;
+    packet->payload[5] = retries & 0xFF;
+    packet->payload[6] = (retries >> 8) & 0xFF;
+    packet->payload_length =
+        sizeof(mode) + sizeof(reads) + sizeof(crc_errors) + sizeof(retries);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_response_owi_get_stats(packet_t *packet, uint8_t *mode,
+                                   uint16_t *reads, uint16_t *crc_errors,
+                                   uint16_t *retries) {
+    *mode = packet->payload[0];
+    *reads = packet->payload[1] | (packet->payload[2] << 8);
+    *crc_errors = packet->payload[3] | (packet->payload[4] << 8);
+    *retries = packet->payload[5] | (packet->payload[6] << 8);
+}
+
+void decode_cmd_device(packet_t *packet, uint8_t *device) {
+    *device = packet->payload[0];
+}
+
+void encode_cmd_ec_measure(packet_t *packet, uint8_t device) {
+    packet->id = PACKET_ID_CMD_EC_MEASURE;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void encode_cmd_ec_import_calib(packet_t *packet, uint8_t device,
+                                uint8_t chunk, uint8_t n_chunks,
+                                const uint8_t *data, uint8_t length) {
     packet->id = PACKET_ID_CMD_EC_IMPORT_CALIB;
+    packet->payload[0] = device;
+    packet->payload[1] = chunk;
+    packet->payload[2] = n_chunks;
     for (uint8_t i = 0; i < length; i++) {
-        packet->payload[i] = data[i];
+        packet->payload[3 + i] = data[i];
     }
-    packet->payload_length = length;
+    packet->payload_length =
+        sizeof(device) + sizeof(chunk) + sizeof(n_chunks) + length;
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_export_calib(packet_t *packet) {
+void decode_cmd_ec_import_calib(packet_t *packet, uint8_t *device,
+                                uint8_t *chunk, uint8_t *n_chunks,
+                                uint8_t *data, uint8_t *length) {
+    *device = packet->payload[0];
+    *chunk = packet->payload[1];
+    *n_chunks = packet->payload[2];
+    *length = packet->payload_length - sizeof(*device) - sizeof(*chunk) -
+              sizeof(*n_chunks);
+    for (uint8_t i = 0; i < *length; i++) {
+        data[i] = packet->payload[3 + i];
+    }
+}
+
+void encode_cmd_ec_export_calib(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_EC_EXPORT_CALIB;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_clear_calib(packet_t *packet) {
+void encode_cmd_ec_clear_calib(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_EC_CLEAR_CALIB;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_calib_dry(packet_t *packet) {
+void encode_cmd_ec_calib_dry(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_EC_CALIB_DRY;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_calib_low(packet_t *packet) {
+void encode_cmd_ec_calib_low(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_EC_CALIB_LOW;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_calib_high(packet_t *packet) {
+void encode_cmd_ec_calib_high(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_EC_CALIB_HIGH;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ec_compensation(packet_t *packet, float temperature) {
-    uint32_t value = (uint32_t)(temperature * 100);
+void encode_cmd_ec_compensation(packet_t *packet, uint8_t device,
+                                int16_t centi_degrees) {
+    uint32_t value = (uint32_t)(int32_t)centi_degrees;
     packet->id = PACKET_ID_CMD_EC_COMPENSATION;
-    packet->payload[0] = (uint8_t)(value & 0xFF);
-    packet->payload[1] = (uint8_t)((value >> 8) & 0xFF);
-    packet->payload[2] = (uint8_t)((value >> 16) & 0xFF);
-    packet->payload[3] = (uint8_t)((value >> 24) & 0xFF);
-    packet->packet_length = sizeof(value);
+    packet->payload[0] = device;
+    packet->payload[1] = (uint8_t)(value & 0xFF);
+    packet->payload[2] = (uint8_t)((value >> 8) & 0xFF);
+    packet->payload[3] = (uint8_t)((value >> 16) & 0xFF);
+    packet->payload[4] = (uint8_t)((value >> 24) & 0xFF);
+    packet->payload_length = sizeof(device) + sizeof(value);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void decode_cmd_ec_compensation(packet_t *packet, float *temperature) {
+void decode_cmd_ec_compensation(packet_t *packet, uint8_t *device,
+                                int16_t *centi_degrees) {
     uint32_t value = 0;
-    value = packet->payload[0] | ((uint32_t)packet->payload[1] << 8) |
-            ((uint32_t)packet->payload[2] << 16) | ((uint32_t)packet->payload[3] << 24);
-    *temperature = (float)value / 100.0;
+    *device = packet->payload[0];
+    value = packet->payload[1] | ((uint32_t)packet->payload[2] << 8) |
+            ((uint32_t)packet->payload[3] << 16) |
+            ((uint32_t)packet->payload[4] << 24);
+    *centi_degrees = (int16_t)(int32_t)value;
 }
 
-void encode_data_ec(packet_t *packet, uint32_t value) {
+void encode_data_ec(packet_t *packet, uint8_t device, uint32_t value) {
     packet->id = PACKET_ID_DATA_EC;
-    packet->payload[0] = (uint8_t)(value & 0xFF);
-    packet->payload[1] = (uint8_t)((value >> 8) & 0xFF);
-    packet->payload[2] = (uint8_t)((value >> 16) & 0xFF);
-    packet->payload[3] = (uint8_t)((value >> 24) & 0xFF);
-    packet->payload_length = sizeof(value);
+    packet->payload[0] = device;
+    packet->payload[1] = (uint8_t)(value & 0xFF);
+    packet->payload[2] = (uint8_t)((value >> 8) & 0xFF);
+    packet->payload[3] = (uint8_t)((value >> 16) & 0xFF);
+    packet->payload[4] = (uint8_t)((value >> 24) & 0xFF);
+    packet->payload_length = sizeof(device) + sizeof(value);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void encode_cmd_water_measure(packet_t *packet) {
+    packet->id = PACKET_ID_CMD_WATER_MEASURE;
+    packet->payload_length = 0;
     packet->packet_length = compute_packet_length(packet);
 }
 
+void encode_data_water(packet_t *packet, uint8_t count, uint8_t valid,
+                       const uint8_t *types, const uint32_t *values) {
+    packet->id = PACKET_ID_DATA_WATER;
+    packet->payload[0] = count;
+    packet->payload[1] = valid;
+    for (uint8_t i = 0; i < count; i++) {
+        packet->payload[2 + 5 * i] = types[i];
+        for (uint8_t j = 0; j < sizeof(values[i]); j++) {
+            packet->payload[3 + 5 * i + j] =
+                (uint8_t)((values[i] >> (8 * j)) & 0xFF);
+        }
+    }
+    packet->payload_length = sizeof(count) + sizeof(valid) + 5 * count;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_data_water(packet_t *packet, uint8_t *count, uint8_t *valid,
+                       uint8_t *types, uint32_t *values) {
+    *count = packet->payload[0];
+    *valid = packet->payload[1];
+    for (uint8_t i = 0; i < *count; i++) {
+        types[i] = packet->payload[2 + 5 * i];
+        values[i] = 0;
+        for (uint8_t j = 0; j < sizeof(values[i]); j++) {
+            values[i] |= (uint32_t)packet->payload[3 + 5 * i + j] << (8 * j);
+        }
+    }
+}
+
+void encode_cmd_water_set_sensors(packet_t *packet, uint8_t device,
+                                  uint8_t count, const uint8_t (*roms)[8]) {
+    packet->id = PACKET_ID_CMD_WATER_SET_SENSORS;
+    packet->payload[0] = device;
+    packet->payload[1] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t j = 0; j < OWI_ROM_SIZE; j++) {
+            packet->payload[2 + OWI_ROM_SIZE * i + j] = roms[i][j];
+        }
+    }
+    packet->payload_length =
+        sizeof(device) + sizeof(count) + OWI_ROM_SIZE * count;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_water_set_sensors(packet_t *packet, uint8_t *device,
+                                  uint8_t *count, uint8_t (*roms)[8]) {
+    *device = packet->payload[0];
+    *count = packet->payload[1];
+    for (uint8_t i = 0; i < *count; i++) {
+        for (uint8_t j = 0; j < OWI_ROM_SIZE; j++) {
+            roms[i][j] = packet->payload[2 + OWI_ROM_SIZE * i + j];
+        }
+    }
+}
+
+void encode_cmd_probe_set_device(packet_t *packet, uint8_t device,
+                                 uint8_t type, uint8_t address,
+                                 uint8_t uart_id, uint8_t enable_port,
+                                 uint8_t enable_pin) {
+    packet->id = PACKET_ID_CMD_PROBE_SET_DEVICE;
+    packet->payload[0] = device;
+    packet->payload[1] = type;
+    packet->payload[2] = address;
+    packet->payload[3] = uart_id;
+    packet->payload[4] = enable_port;
+    packet->payload[5] = enable_pin;
+    packet->payload_length = sizeof(device) + sizeof(type) + sizeof(address) +
+                             sizeof(uart_id) + sizeof(enable_port) +
+                             sizeof(enable_pin);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_probe_set_device(packet_t *packet, uint8_t *device,
+                                 uint8_t *type, uint8_t *address,
+                                 uint8_t *uart_id, uint8_t *enable_port,
+                                 uint8_t *enable_pin) {
+    *device = packet->payload[0];
+    *type = packet->payload[1];
+    *address = packet->payload[2];
+    *uart_id = packet->payload[3];
+    *enable_port = packet->payload[4];
+    *enable_pin = packet->payload[5];
+}
+
 void encode_response_ec_get_calib_format(packet_t *packet, uint8_t n_strings,
                                          uint8_t n_bytes) {
     packet->id = PACKET_ID_RESPONSE_EC_GET_CALIB_FORMAT;
@@ -170,19 +425,38 @@ void encode_response_ec_get_calib_format(packet_t *packet, uint8_t n_strings,
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_response_ec_export_calib(packet_t *packet, uint8_t *data,
-                                     uint8_t length) {
+void encode_response_ec_export_calib(packet_t *packet, uint8_t device,
+                                     uint8_t chunk, uint8_t n_chunks,
+                                     const uint8_t *data, uint8_t length) {
     packet->id = PACKET_ID_RESPONSE_EC_EXPORT_CALIB;
+    packet->payload[0] = device;
+    packet->payload[1] = chunk;
+    packet->payload[2] = n_chunks;
     for (uint8_t i = 0; i < length; i++) {
-        packet->payload[i] = data[i];
+        packet->payload[3 + i] = data[i];
     }
-    packet->payload_length = length;
+    packet->payload_length =
+        sizeof(device) + sizeof(chunk) + sizeof(n_chunks) + length;
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_measure(packet_t *packet) {
+void decode_response_ec_export_calib(packet_t *packet, uint8_t *device,
+                                     uint8_t *chunk, uint8_t *n_chunks,
+                                     uint8_t *data, uint8_t *length) {
+    *device = packet->payload[0];
+    *chunk = packet->payload[1];
+    *n_chunks = packet->payload[2];
+    *length = packet->payload_length - sizeof(*device) - sizeof(*chunk) -
+              sizeof(*n_chunks);
+    for (uint8_t i = 0; i < *length; i++) {
+        data[i] = packet->payload[3 + i];
+    }
+}
+
+void encode_cmd_ph_measure(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_PH_MEASURE;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
@@ -192,70 +466,99 @@ void encode_cmd_ph_get_calib_format(packet_t *packet) {
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_import_calib(packet_t *packet, uint8_t *data,
-                                uint8_t length) {
+void encode_cmd_ph_import_calib(packet_t *packet, uint8_t device,
+                                uint8_t chunk, uint8_t n_chunks,
+                                const uint8_t *data, uint8_t length) {
     packet->id = PACKET_ID_CMD_PH_IMPORT_CALIB;
+    packet->payload[0] = device;
+    packet->payload[1] = chunk;
+    packet->payload[2] = n_chunks;
     for (uint8_t i = 0; i < length; i++) {
-        packet->payload[i] = data[i];
+        packet->payload[3 + i] = data[i];
     }
-    packet->payload_length = length;
+    packet->payload_length =
+        sizeof(device) + sizeof(chunk) + sizeof(n_chunks) + length;
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_export_calib(packet_t *packet) {
+void decode_cmd_ph_import_calib(packet_t *packet, uint8_t *device,
+                                uint8_t *chunk, uint8_t *n_chunks,
+                                uint8_t *data, uint8_t *length) {
+    *device = packet->payload[0];
+    *chunk = packet->payload[1];
+    *n_chunks = packet->payload[2];
+    *length = packet->payload_length - sizeof(*device) - sizeof(*chunk) -
+              sizeof(*n_chunks);
+    for (uint8_t i = 0; i < *length; i++) {
+        data[i] = packet->payload[3 + i];
+    }
+}
+
+void encode_cmd_ph_export_calib(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_PH_EXPORT_CALIB;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_clear_calib(packet_t *packet) {
+void encode_cmd_ph_clear_calib(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_PH_CLEAR_CALIB;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_calib_low(packet_t *packet) {
+void encode_cmd_ph_calib_low(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_PH_CALIB_LOW;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_calib_mid(packet_t *packet) {
+void encode_cmd_ph_calib_mid(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_PH_CALIB_MID;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
-void encode_cmd_ph_calib_high(packet_t *packet) {
+void encode_cmd_ph_calib_high(packet_t *packet, uint8_t device) {
     packet->id = PACKET_ID_CMD_PH_CALIB_HIGH;
-    packet->payload_length = 0;
+    packet->payload[0] = device;
+    packet->payload_length = sizeof(device);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_cmd_ph_compensation(packet_t *packet, float temperature) {
-    uint32_t value = (uint32_t)(temperature * 100);
+void encode_cmd_ph_compensation(packet_t *packet, uint8_t device,
+                                int16_t centi_degrees) {
+    uint32_t value = (uint32_t)(int32_t)centi_degrees;
     packet->id = PACKET_ID_CMD_PH_COMPENSATION;
-    packet->payload[0] = (uint8_t)(value & 0xFF);
-    packet->payload[1] = (uint8_t)((value >> 8) & 0xFF);
-    packet->payload[2] = (uint8_t)((value >> 16) & 0xFF);
-    packet->payload[3] = (uint8_t)((value >> 24) & 0xFF);
-    packet->packet_length = sizeof(value);
+    packet->payload[0] = device;
+    packet->payload[1] = (uint8_t)(value & 0xFF);
+    packet->payload[2] = (uint8_t)((value >> 8) & 0xFF);
+    packet->payload[3] = (uint8_t)((value >> 16) & 0xFF);
+    packet->payload[4] = (uint8_t)((value >> 24) & 0xFF);
+    packet->payload_length = sizeof(device) + sizeof(value);
     packet->packet_length = compute_packet_length(packet);
 }
 
-void decode_cmd_ph_compensation(packet_t *packet, float *temperature) {
+void decode_cmd_ph_compensation(packet_t *packet, uint8_t *device,
+                                int16_t *centi_degrees) {
     uint32_t value = 0;
-    value = packet->payload[0] | ((uint32_t)packet->payload[1] << 8) |
-            ((uint32_t)packet->payload[2] << 16) | ((uint32_t)packet->payload[3] << 24);
-    *temperature = (float)value / 100.0;
+    *device = packet->payload[0];
+    value = packet->payload[1] | ((uint32_t)packet->payload[2] << 8) |
+            ((uint32_t)packet->payload[3] << 16) |
+            ((uint32_t)packet->payload[4] << 24);
+    *centi_degrees = (int16_t)(int32_t)value;
 }
 
-void encode_data_ph(packet_t *packet, uint32_t data) {
+void encode_data_ph(packet_t *packet, uint8_t device, uint32_t value) {
     packet->id = PACKET_ID_DATA_PH;
-    packet->payload[0] = (uint8_t)(data & 0xFF);
-    packet->payload[1] = (uint8_t)((data >> 8) & 0xFF);
-    packet->payload[2] = (uint8_t)((data >> 16) & 0xFF);
-    packet->payload[3] = (uint8_t)((data >> 24) & 0xFF);
-    packet->payload_length = sizeof(data);
+    packet->payload[0] = device;
+    packet->payload[1] = (uint8_t)(value & 0xFF);
+    packet->payload[2] = (uint8_t)((value >> 8) & 0xFF);
+    packet->payload[3] = (uint8_t)((value >> 16) & 0xFF);
+    packet->payload[4] = (uint8_t)((value >> 24) & 0xFF);
+    packet->payload_length = sizeof(device) + sizeof(value);
     packet->packet_length = compute_packet_length(packet);
 }
 
@@ -268,16 +571,34 @@ void encode_response_ph_get_calib_format(packet_t *packet, uint8_t n_strings,
     packet->packet_length = compute_packet_length(packet);
 }
 
-void encode_response_ph_export_calib(packet_t *packet, uint8_t *data,
-                                     uint8_t length) {
+void encode_response_ph_export_calib(packet_t *packet, uint8_t device,
+                                     uint8_t chunk, uint8_t n_chunks,
+                                     const uint8_t *data, uint8_t length) {
     packet->id = PACKET_ID_RESPONSE_PH_EXPORT_CALIB;
+    packet->payload[0] = device;
+    packet->payload[1] = chunk;
+    packet->payload[2] = n_chunks;
     for (uint8_t i = 0; i < length; i++) {
-        packet->payload[i] = data[i];
+        packet->payload[3 + i] = data[i];
     }
-    packet->payload_length = length;
+    packet->payload_length =
+        sizeof(device) + sizeof(chunk) + sizeof(n_chunks) + length;
     packet->packet_length = compute_packet_length(packet);
 }
 
+void decode_response_ph_export_calib(packet_t *packet, uint8_t *device,
+                                     uint8_t *chunk, uint8_t *n_chunks,
+                                     uint8_t *data, uint8_t *length) {
+    *device = packet->payload[0];
+    *chunk = packet->payload[1];
+    *n_chunks = packet->payload[2];
+    *length = packet->payload_length - sizeof(*device) - sizeof(*chunk) -
+              sizeof(*n_chunks);
+    for (uint8_t i = 0; i < *length; i++) {
+        data[i] = packet->payload[3 + i];
+    }
+}
+
 void encode_cmd_light_set(packet_t *packet, uint8_t state) {
     packet->id = PACKET_ID_CMD_LIGHT_SET;
     packet->payload[0] = state;
@@ -432,6 +753,160 @@ void decode_response_fan_get_speed(packet_t *packet, uint8_t *index,
     *speed = (uint16_t)packet->payload[1] | (packet->payload[2] << 8);
 }
 
+void encode_cmd_fan_set_speeds(packet_t *packet, uint8_t count,
+                               const uint8_t *indices, const uint16_t *speeds) {
+    uint8_t offset = 1;
+    packet->id = PACKET_ID_CMD_FAN_SET_SPEEDS;
+    packet->payload[0] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        packet->payload[offset++] = indices[i];
+        packet->payload[offset++] = (uint8_t)(speeds[i] & 0xFF);
+        packet->payload[offset++] = (uint8_t)((speeds[i] >> 8) & 0xFF);
+    }
+    packet->payload_length = offset;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_fan_set_speeds(packet_t *packet, uint8_t *count,
+                               uint8_t *indices, uint16_t *speeds) {
+    uint8_t offset = 1;
+    *count = packet->payload[0];
+    for (uint8_t i = 0; i < *count; i++) {
+        indices[i] = packet->payload[offset++];
+        speeds[i] = (uint16_t)packet->payload[offset] |
+                    (packet->payload[offset + 1] << 8);
+        offset += 2;
+    }
+}
+
+void encode_cmd_pwm_ramp(packet_t *packet, uint8_t index, uint16_t target,
+                         uint32_t duration_ms, uint8_t curve) {
+    packet->id = PACKET_ID_CMD_PWM_RAMP;
+    packet->payload[0] = index;
+    packet->payload[1] = (uint8_t)(target & 0xFF);
+    packet->payload[2] = (uint8_t)((target >> 8) & 0xFF);
+    for (uint8_t i = 0; i < sizeof(duration_ms); i++) {
+        packet->payload[3 + i] = (uint8_t)((duration_ms >> (8 * i)) & 0xFF);
+    }
+    packet->payload[7] = curve;
+    packet->payload_length =
+        sizeof(index) + sizeof(target) + sizeof(duration_ms) + sizeof(curve);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_pwm_ramp(packet_t *packet, uint8_t *index, uint16_t *target,
+                         uint32_t *duration_ms, uint8_t *curve) {
+    *index = packet->payload[0];
+    *target = (uint16_t)packet->payload[1] | (packet->payload[2] << 8);
+    *duration_ms = 0;
+    for (uint8_t i = 0; i < sizeof(*duration_ms); i++) {
+        *duration_ms |= (uint32_t)packet->payload[3 + i] << (8 * i);
+    }
+    *curve = packet->payload[7];
+}
+
+void encode_cmd_fan_control_set_levels(packet_t *packet, uint8_t count,
+                                       const int16_t *lows,
+                                       const int16_t *highs,
+                                       const uint16_t *pwms) {
+    uint8_t offset = 1;
+    packet->id = PACKET_ID_CMD_FAN_CONTROL_SET_LEVELS;
+    packet->payload[0] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        packet->payload[offset++] = (uint8_t)(lows[i] & 0xFF);
+        packet->payload[offset++] = (uint8_t)((lows[i] >> 8) & 0xFF);
+        packet->payload[offset++] = (uint8_t)(highs[i] & 0xFF);
+        packet->payload[offset++] = (uint8_t)((highs[i] >> 8) & 0xFF);
+        packet->payload[offset++] = (uint8_t)(pwms[i] & 0xFF);
+        packet->payload[offset++] = (uint8_t)((pwms[i] >> 8) & 0xFF);
+    }
+    packet->payload_length = offset;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_fan_control_set_levels(packet_t *packet, uint8_t *count,
+                                       int16_t *lows, int16_t *highs,
+                                       uint16_t *pwms) {
+    uint8_t *data = &packet->payload[1];
+    *count = packet->payload[0];
+    for (uint8_t i = 0; i < *count; i++, data += 6) {
+        lows[i] = (int16_t)((uint16_t)data[0] | (data[1] << 8));
+        highs[i] = (int16_t)((uint16_t)data[2] | (data[3] << 8));
+        pwms[i] = (uint16_t)data[4] | (data[5] << 8);
+    }
+}
+
+void encode_cmd_fan_control_set_sensors(packet_t *packet, uint8_t count,
+                                        const uint8_t (*roms)[8]) {
+    packet->id = PACKET_ID_CMD_FAN_CONTROL_SET_SENSORS;
+    packet->payload[0] = count;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t j = 0; j < OWI_ROM_SIZE; j++) {
+            packet->payload[1 + OWI_ROM_SIZE * i + j] = roms[i][j];
+        }
+    }
+    packet->payload_length = sizeof(count) + OWI_ROM_SIZE * count;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_fan_control_set_sensors(packet_t *packet, uint8_t *count,
+                                        uint8_t (*roms)[8]) {
+    *count = packet->payload[0];
+    for (uint8_t i = 0; i < *count; i++) {
+        for (uint8_t j = 0; j < OWI_ROM_SIZE; j++) {
+            roms[i][j] = packet->payload[1 + OWI_ROM_SIZE * i + j];
+        }
+    }
+}
+
+void encode_cmd_fan_control_enable(packet_t *packet, uint8_t enabled,
+                                   uint16_t channels) {
+    packet->id = PACKET_ID_CMD_FAN_CONTROL_ENABLE;
+    packet->payload[0] = enabled;
+    packet->payload[1] = (uint8_t)(channels & 0xFF);
+    packet->payload[2] = (uint8_t)((channels >> 8) & 0xFF);
+    packet->payload_length = sizeof(enabled) + sizeof(channels);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_cmd_fan_control_enable(packet_t *packet, uint8_t *enabled,
+                                   uint16_t *channels) {
+    *enabled = packet->payload[0];
+    *channels = (uint16_t)packet->payload[1] | (packet->payload[2] << 8);
+}
+
+void encode_cmd_fan_control_get_state(packet_t *packet) {
+    packet->id = PACKET_ID_CMD_FAN_CONTROL_GET_STATE;
+    packet->payload_length = 0;
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void encode_response_fan_control_get_state(packet_t *packet, uint8_t enabled,
+                                           uint8_t level, int16_t temperature,
+                                           uint16_t pwm) {
+    packet->id = PACKET_ID_RESPONSE_FAN_CONTROL_GET_STATE;
+    packet->payload[0] = enabled;
+    packet->payload[1] = level;
+    packet->payload[2] = (uint8_t)(temperature & 0xFF);
+    packet->payload[3] = (uint8_t)((temperature >> 8) & 0xFF);
+    packet->payload[4] = (uint8_t)(pwm & 0xFF);
+    packet->payload[5] = (uint8_t)((pwm >> 8) & 0xFF);
+    packet->payload_length =
+        sizeof(enabled) + sizeof(level) + sizeof(temperature) + sizeof(pwm);
+    packet->packet_length = compute_packet_length(packet);
+}
+
+void decode_response_fan_control_get_state(packet_t *packet, uint8_t *enabled,
+                                           uint8_t *level,
+                                           int16_t *temperature,
+                                           uint16_t *pwm) {
+    *enabled = packet->payload[0];
+    *level = packet->payload[1];
+    *temperature =
+        (int16_t)((uint16_t)packet->payload[2] | (packet->payload[3] << 8));
+    *pwm = (uint16_t)packet->payload[4] | (packet->payload[5] << 8);
+}
+
 void encode_ready_request(packet_t *packet) {
     packet->id = PACKET_ID_READY_REQUEST;
     packet->payload_length = 0;
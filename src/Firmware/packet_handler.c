@@ -2,19 +2,27 @@
 
 #include <stdlib.h>
 
-#include "ec.h"
+#include "compensation.h"
+#include "fan_control.h"
 #include "owi.h"
 #include "packet.h"
-#include "ph.h"
+#include "probe.h"
 #include "pwm.h"
 #include "relays.h"
 #include "serial.h"
+#include "temperature.h"
+#include "timer.h"
 
 void handle_cmd_owi_set_res(packet_t *packet) {
     return_status_t status;
     uint8_t resolution;
     decode_cmd_owi_set_res(packet, &resolution);
-    status = owi_set_resolution_all(resolution);
+    if (temperature_busy()) {
+        serial_warning(SERIAL_SRC_OWI,
+                       "Measurement in progress. Resolution was not set.");
+        return;
+    }
+    status = temperature_set_resolution(resolution);
     if (status != RET_SUCCESS) {
         switch (status) {
             case RET_OWI_UNKNOWN_RES:
@@ -47,166 +55,461 @@ void handle_cmd_owi_get_res(packet_t *packet) {
     serial_send_packet(packet);
 }
 
+static void owi_measure_done(temperature_sample_t *sample) {
+    packet_t packet;
+    uint32_t age = timer_elapsed_ms(sample->timestamp_ms);
+    encode_data_owi(&packet, sample->device.rom, sample->device.temperature,
+                    age > UINT16_MAX ? UINT16_MAX : (uint16_t)age);
+    serial_send_packet(&packet);
+}
+
 void handle_cmd_owi_measure(packet_t *packet) {
     serial_info(SERIAL_SRC_OWI, "Handling measure");
-    uint8_t count = 1;
     return_status_t status;
-    ds18b20_t device;
-    owi_start_conversion();
-    owi_wait_conversion(NULL);
-    status = owi_search_first();
+    (void)packet;
+    status = temperature_measure(owi_measure_done);
     if (status != RET_SUCCESS) {
         serial_error(SERIAL_SRC_OWI,
                      "Could not measure temperature. Exit code: %d", status);
+    }
+}
+
+static void owi_alarms_done(uint8_t n_alarms) {
+    packet_t packet;
+    encode_response_owi_measure_alarms(&packet, n_alarms);
+    serial_send_packet(&packet);
+}
+
+void handle_cmd_owi_measure_alarms(packet_t *packet) {
+    return_status_t status;
+    (void)packet;
+    status = temperature_measure_alarms(owi_measure_done, owi_alarms_done);
+    if (status == RET_OWI_BUSY) {
+        serial_warning(SERIAL_SRC_OWI,
+                       "Measurement in progress. Alarms were not checked.");
+    } else if (status != RET_SUCCESS) {
+        serial_error(SERIAL_SRC_OWI, "Could not check alarms. Exit code: %d",
+                     status);
+    }
+}
+
+void handle_cmd_owi_set_alarm(packet_t *packet) {
+    return_status_t status;
+    uint8_t rom[8];
+    int8_t high, low;
+    decode_cmd_owi_set_alarm(packet, rom, &high, &low);
+    if (temperature_busy()) {
+        serial_warning(SERIAL_SRC_OWI,
+                       "Measurement in progress. Alarm was not set.");
         return;
     }
-    owi_get_buffered_rom(device.rom);
-    owi_get_resolution_all(&device.resolution);
-    status = owi_read_temperature(&device);
-    encode_data_owi(packet, device.rom, device.temperature);
-    serial_send_packet(packet);
-    while (status == RET_SUCCESS) {
-        status = owi_search_next();
-        if (status != RET_SUCCESS) {
-            // break loop. We have read out all temperatures
-            if (status != RET_OWI_SEARCH_LAST_DEVICE) {
-                serial_error(SERIAL_SRC_OWI,
-                             "Could not measure temeprature. Exit code: %d",
-                             status);
-            }
-            serial_debug(SERIAL_SRC_OWI, "Read temperature from %d devices",
-                         count);
-            return;
-        }
-        count++;
-        owi_get_buffered_rom(device.rom);
-        status = owi_read_temperature(&device);
-        encode_data_owi(packet, device.rom, device.temperature);
-        serial_send_packet(packet);
+    status = temperature_set_alarm(rom, high, low);
+    if (status == RET_OWI_UNKNOWN_DEVICE) {
+        serial_warning(SERIAL_SRC_OWI, "Unknown sensor. Alarm was not set.");
+    } else if (status != RET_SUCCESS) {
+        serial_warning(SERIAL_SRC_OWI, "Could not set alarm. Exit code: %d",
+                       status);
     }
-    serial_error(SERIAL_SRC_OWI, "Could not measure temperature. Exit code: %d",
-                 status);
 }
 
-void handle_cmd_ec_measure(packet_t *packet) {
-    uint32_t ec;
+void handle_cmd_owi_set_profile(packet_t *packet) {
     return_status_t status;
-    status = ec_read_ec(&ec);
-    if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_EC, "Could not measre EC. Exit code: %d",
-                     status);
+    uint8_t rom[8];
+    uint8_t res, adaptive;
+    decode_cmd_owi_set_profile(packet, rom, &res, &adaptive);
+    if (temperature_busy()) {
+        serial_warning(SERIAL_SRC_OWI,
+                       "Measurement in progress. Profile was not set.");
         return;
     }
-    encode_data_ec(packet, ec);
+    status = temperature_set_profile(rom, res, adaptive);
+    if (status == RET_OWI_UNKNOWN_DEVICE) {
+        serial_warning(SERIAL_SRC_OWI, "Unknown sensor. Profile was not set.");
+    } else if (status != RET_SUCCESS) {
+        serial_warning(SERIAL_SRC_OWI, "Could not set profile. Exit code: %d",
+                       status);
+    }
+}
+
+void handle_cmd_owi_set_sampling(packet_t *packet) {
+    uint32_t period_ms;
+    uint32_t max_age_ms;
+    decode_cmd_owi_set_sampling(packet, &period_ms, &max_age_ms);
+    temperature_set_sampling(period_ms, max_age_ms);
+}
+
+void handle_cmd_owi_set_read_mode(packet_t *packet) {
+    uint8_t mode;
+    decode_cmd_owi_set_read_mode(packet, &mode);
+    if (mode != OWI_READ_VERIFIED && mode != OWI_READ_FAST) {
+        serial_warning(SERIAL_SRC_OWI, "Unknown read mode: %hu", mode);
+        return;
+    }
+    temperature_set_read_mode(mode);
+}
+
+void handle_cmd_owi_get_stats(packet_t *packet) {
+    owi_stats_t stats;
+    temperature_get_stats(&stats);
+    encode_response_owi_get_stats(packet, temperature_get_read_mode(),
+                                  stats.reads, stats.crc_errors,
+                                  stats.retries);
     serial_send_packet(packet);
 }
 
-void handle_cmd_ec_import_calib(packet_t *packet) {}
-void handle_cmd_ec_export_calib(packet_t *packet) {}
-void handle_cmd_ec_clear_calib(packet_t *packet) {
-    return_status_t status;
-    status = ec_calibration_clear();
+typedef void (*data_encoder_t)(packet_t *packet, uint8_t device,
+                               uint32_t value);
+typedef void (*calib_decoder_t)(packet_t *packet, uint8_t *device,
+                                uint8_t *chunk, uint8_t *n_chunks,
+                                uint8_t *data, uint8_t *length);
+typedef void (*calib_encoder_t)(packet_t *packet, uint8_t device,
+                                uint8_t chunk, uint8_t n_chunks,
+                                const uint8_t *data, uint8_t length);
+typedef void (*compensation_decoder_t)(packet_t *packet, uint8_t *device,
+                                       int16_t *t);
+
+/**
+ * @brief Log messages of a failed calibration, see @ref probe_calibration_t.
+ */
+static const char *const calibration_actions[PROBE_N_CALIBRATIONS] = {
+    "clear calibration", "calibrate dry", "calibrate low", "calibrate mid",
+    "calibrate high"};
+
+// The EC and pH packets only differ in their IDs, so their handlers share the
+// helpers below. The callbacks of probe.c carry no context, so each type keeps
+// a wrapper that passes its log source and encoder.
+
+static void circuit_measure_done(serial_log_source_t source,
+                                 data_encoder_t encode, uint8_t device,
+                                 return_status_t status, uint32_t value) {
+    packet_t packet;
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_EC,
-                     "Could not clear calibration. Exit code: %d", status);
+        serial_error(source, "Could not measure device %hu. Exit code: %d",
+                     device, status);
+        return;
     }
+    encode(&packet, device, value);
+    serial_send_packet(&packet);
 }
-void handle_cmd_ec_calib_dry(packet_t *packet) {
+
+static void circuit_measure(packet_t *packet, probe_type_t type,
+                            probe_callback_t callback) {
     return_status_t status;
-    status = ec_calibration_dry();
+    uint8_t device;
+    decode_cmd_device(packet, &device);
+    status = probe_read(device, type, callback);
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_EC, "Could not calibrate dry. Exit code: %d",
-                     status);
+        callback(device, status, 0);
     }
 }
 
-void handle_cmd_ec_calib_low(packet_t *packet) {
-    return_status_t status;
-    status = ec_calibration_low();
+static void circuit_import_calib_done(serial_log_source_t source,
+                                      return_status_t status) {
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_EC, "Could not calibrate low. Exit code: %d",
+        serial_error(source, "Could not import calibration. Exit code: %d",
                      status);
     }
 }
 
-void handle_cmd_ec_calib_high(packet_t *packet) {
+/**
+ * @brief Takes a chunk of a calibration, or imports the cached calibration if
+ * the packet holds the device index only.
+ */
+static void circuit_import_calib(packet_t *packet, probe_type_t type,
+                                 calib_decoder_t decode,
+                                 ezo_calibration_callback_t callback) {
     return_status_t status;
-    status = ec_calibration_high();
+    uint8_t device, chunk, n_chunks, length;
+    uint8_t data[EZO_CALIBRATION_CHUNK_SIZE];
+    if (packet->payload_length == 1) {
+        decode_cmd_device(packet, &device);
+        status = probe_calibration_restore(device, type, callback);
+    } else if (packet->payload_length < 3 ||
+               packet->payload_length > 3 + EZO_CALIBRATION_CHUNK_SIZE) {
+        status = RET_PACKET_LENGTH_MISMATCH;
+    } else {
+        decode(packet, &device, &chunk, &n_chunks, data, &length);
+        status = probe_calibration_import(device, type, chunk, n_chunks, data,
+                                          length, callback);
+    }
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_EC, "Could not calibrate high. Exit code: %d",
-                     status);
+        callback(NULL, status);
     }
 }
 
-void handle_cmd_ec_compensation(packet_t *packet) {
-    return_status_t status;
-    float t;
-    decode_cmd_ec_compensation(packet, &t);
-    status = ec_temperature_compensation(t);
+static void circuit_export_calib_done(serial_log_source_t source,
+                                      calib_encoder_t encode, ezo_t *device,
+                                      return_status_t status) {
+    packet_t packet;
+    uint8_t data[EZO_CALIBRATION_CHUNK_SIZE];
+    uint8_t index, n_chunks, length;
+    uint8_t chunk = 0;
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_EC,
-                     "Could not set temperature compensation. Exit code. %d",
+        serial_error(source, "Could not export calibration. Exit code: %d",
                      status);
+        return;
     }
+    index = probe_index(device);
+    // an empty calibration is sent as a single chunk of zero chunks
+    do {
+        length = probe_calibration_chunk(index, chunk, data, &n_chunks);
+        encode(&packet, index, chunk, n_chunks, data, length);
+        serial_send_packet(&packet);
+        chunk++;
+    } while (chunk < n_chunks);
 }
 
-void handle_cmd_ph_measure(packet_t *packet) {
-    uint32_t ph;
+static void circuit_export_calib(packet_t *packet, probe_type_t type,
+                                 ezo_calibration_callback_t callback) {
     return_status_t status;
-    status = ph_read_ph(&ph);
+    uint8_t device;
+    decode_cmd_device(packet, &device);
+    status = probe_calibration_export(device, type, callback);
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_PH, "Could not measure PH. Exit code: %d",
-                     status);
-        return;
+        callback(NULL, status);
     }
-    encode_data_ph(packet, ph);
-    serial_send_packet(packet);
 }
-void handle_cmd_ph_import_calib(packet_t *packet) {}
-void handle_cmd_ph_export_calib(packet_t *packet) {}
-void handle_cmd_ph_clear_calib(packet_t *packet) {
+
+static void circuit_calibrate(packet_t *packet, probe_type_t type,
+                              serial_log_source_t source,
+                              probe_calibration_t point) {
     return_status_t status;
-    status = ph_calibration_clear();
+    uint8_t device;
+    decode_cmd_device(packet, &device);
+    status = probe_calibrate(device, type, point);
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_PH,
-                     "Could not clear calibration. Exit code: %d", status);
+        serial_error(source, "Could not %s. Exit code: %d",
+                     calibration_actions[point], status);
     }
 }
-void handle_cmd_ph_calib_low(packet_t *packet) {
+
+static void circuit_compensation(packet_t *packet, probe_type_t type,
+                                 serial_log_source_t source,
+                                 compensation_decoder_t decode) {
     return_status_t status;
-    status = ph_calibration_low();
+    uint8_t device;
+    int16_t t;
+    decode(packet, &device, &t);
+    status = probe_temperature_compensation(device, type, t);
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_PH, "Could not calibrate low. Exit code: %d",
+        serial_error(source,
+                     "Could not set temperature compensation. Exit code. %d",
                      status);
     }
 }
 
+static void ec_measure_done(uint8_t device, return_status_t status,
+                            uint32_t value) {
+    circuit_measure_done(SERIAL_SRC_EC, encode_data_ec, device, status, value);
+}
+
+void handle_cmd_ec_measure(packet_t *packet) {
+    circuit_measure(packet, PROBE_TYPE_EC, ec_measure_done);
+}
+
+static void ec_import_calib_done(ezo_t *device, return_status_t status) {
+    (void)device;
+    circuit_import_calib_done(SERIAL_SRC_EC, status);
+}
+
+void handle_cmd_ec_import_calib(packet_t *packet) {
+    circuit_import_calib(packet, PROBE_TYPE_EC, decode_cmd_ec_import_calib,
+                         ec_import_calib_done);
+}
+
+static void ec_export_calib_done(ezo_t *device, return_status_t status) {
+    circuit_export_calib_done(SERIAL_SRC_EC, encode_response_ec_export_calib,
+                              device, status);
+}
+
+void handle_cmd_ec_export_calib(packet_t *packet) {
+    circuit_export_calib(packet, PROBE_TYPE_EC, ec_export_calib_done);
+}
+
+void handle_cmd_ec_clear_calib(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_EC, SERIAL_SRC_EC,
+                      PROBE_CALIBRATION_CLEAR);
+}
+
+void handle_cmd_ec_calib_dry(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_EC, SERIAL_SRC_EC,
+                      PROBE_CALIBRATION_DRY);
+}
+
+void handle_cmd_ec_calib_low(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_EC, SERIAL_SRC_EC,
+                      PROBE_CALIBRATION_LOW);
+}
+
+void handle_cmd_ec_calib_high(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_EC, SERIAL_SRC_EC,
+                      PROBE_CALIBRATION_HIGH);
+}
+
+void handle_cmd_ec_compensation(packet_t *packet) {
+    circuit_compensation(packet, PROBE_TYPE_EC, SERIAL_SRC_EC,
+                         decode_cmd_ec_compensation);
+}
+
+static void ph_measure_done(uint8_t device, return_status_t status,
+                            uint32_t value) {
+    circuit_measure_done(SERIAL_SRC_PH, encode_data_ph, device, status, value);
+}
+
+void handle_cmd_ph_measure(packet_t *packet) {
+    circuit_measure(packet, PROBE_TYPE_PH, ph_measure_done);
+}
+
+static void ph_import_calib_done(ezo_t *device, return_status_t status) {
+    (void)device;
+    circuit_import_calib_done(SERIAL_SRC_PH, status);
+}
+
+void handle_cmd_ph_import_calib(packet_t *packet) {
+    circuit_import_calib(packet, PROBE_TYPE_PH, decode_cmd_ph_import_calib,
+                         ph_import_calib_done);
+}
+
+static void ph_export_calib_done(ezo_t *device, return_status_t status) {
+    circuit_export_calib_done(SERIAL_SRC_PH, encode_response_ph_export_calib,
+                              device, status);
+}
+
+void handle_cmd_ph_export_calib(packet_t *packet) {
+    circuit_export_calib(packet, PROBE_TYPE_PH, ph_export_calib_done);
+}
+
+void handle_cmd_ph_clear_calib(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_PH, SERIAL_SRC_PH,
+                      PROBE_CALIBRATION_CLEAR);
+}
+
+void handle_cmd_ph_calib_low(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_PH, SERIAL_SRC_PH,
+                      PROBE_CALIBRATION_LOW);
+}
+
 void handle_cmd_ph_calib_mid(packet_t *packet) {
-    return_status_t status;
-    status = ph_calibration_mid();
-    if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_PH, "Could not calibrate mid. Exit code: %d",
+    circuit_calibrate(packet, PROBE_TYPE_PH, SERIAL_SRC_PH,
+                      PROBE_CALIBRATION_MID);
+}
+
+void handle_cmd_ph_calib_high(packet_t *packet) {
+    circuit_calibrate(packet, PROBE_TYPE_PH, SERIAL_SRC_PH,
+                      PROBE_CALIBRATION_HIGH);
+}
+
+void handle_cmd_ph_compensation(packet_t *packet) {
+    circuit_compensation(packet, PROBE_TYPE_PH, SERIAL_SRC_PH,
+                         decode_cmd_ph_compensation);
+}
+
+/**
+ * @brief State of a measurement of all circuits. The readings are sent
+ * together once the last circuit is done.
+ */
+static uint8_t water_pending = 0;
+static uint8_t water_valid;
+static uint32_t water_values[PROBE_MAX_DEVICES];
+
+static void water_send() {
+    packet_t packet;
+    uint8_t types[PROBE_MAX_DEVICES];
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        types[i] = probe_type(i);
+    }
+    encode_data_water(&packet, PROBE_MAX_DEVICES, water_valid, types,
+                      water_values);
+    serial_send_packet(&packet);
+}
+
+static void water_reading_done(uint8_t device, return_status_t status,
+                               uint32_t value) {
+    if (status == RET_SUCCESS) {
+        water_values[device] = value;
+        water_valid |= (1 << device);
+    } else {
+        serial_error(SERIAL_SRC_GENERAL,
+                     "Could not measure device %hu. Exit code: %d", device,
                      status);
     }
+    water_pending &= ~(1 << device);
+    if (!water_pending) {
+        water_send();
+    }
 }
 
-void handle_cmd_ph_calib_high(packet_t *packet) {
+/**
+ * @brief Starts a reading of every circuit of the device table. The circuits
+ * convert at the same time, so all of them are read within one conversion
+ * time.
+ */
+void handle_cmd_water_measure(packet_t *packet) {
+    return_status_t status;
+    uint8_t pending = 0;
+    (void)packet;
+    if (water_pending) {
+        serial_warning(SERIAL_SRC_GENERAL,
+                       "Water measurement already in progress.");
+        return;
+    }
+    water_valid = 0;
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        water_values[i] = 0;
+        if (probe_type(i) != PROBE_TYPE_NONE) {
+            pending |= (1 << i);
+        }
+    }
+    // set before the first reading may complete
+    water_pending = pending;
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        if (probe_type(i) == PROBE_TYPE_NONE) {
+            continue;
+        }
+        status = probe_read(i, probe_type(i), water_reading_done);
+        if (status != RET_SUCCESS) {
+            water_reading_done(i, status, 0);
+        }
+    }
+    if (!pending) {
+        water_send();
+    }
+}
+
+void handle_cmd_water_set_sensors(packet_t *packet) {
     return_status_t status;
-    status = ph_calibration_high();
+    uint8_t device, count;
+    uint8_t roms[COMPENSATION_MAX_SENSORS][8];
+    if (packet->payload_length < 2 ||
+        packet->payload[1] > COMPENSATION_MAX_SENSORS ||
+        packet->payload_length != 2 + 8 * packet->payload[1]) {
+        serial_error(SERIAL_SRC_GENERAL, "Invalid water sensors packet.");
+        return;
+    }
+    decode_cmd_water_set_sensors(packet, &device, &count, roms);
+    status = compensation_set_sensors(device, (const uint8_t(*)[8])roms,
+                                      count);
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_PH, "Could not calibrate high. Exit code: %d",
-                     status);
+        serial_error(SERIAL_SRC_GENERAL,
+                     "Could not set water sensors. Exit code: %d", status);
     }
 }
 
-void handle_cmd_ph_compensation(packet_t *packet) {
+void handle_cmd_probe_set_device(packet_t *packet) {
     return_status_t status;
-    float t;
-    decode_cmd_ph_compensation(packet, &t);
-    status = ph_temperature_compensation(t);
+    uint8_t device;
+    probe_config_t config;
+    if (packet->payload_length != 6) {
+        serial_error(SERIAL_SRC_GENERAL, "Invalid probe device packet.");
+        return;
+    }
+    decode_cmd_probe_set_device(packet, &device, &config.type, &config.address,
+                                &config.uart_id, &config.enable_port,
+                                &config.enable_pin);
+    status = probe_set_device(device, &config);
     if (status != RET_SUCCESS) {
-        serial_error(SERIAL_SRC_PH,
-                     "Could not set temperature compensation. Exit code. %d",
+        serial_error(SERIAL_SRC_GENERAL,
+                     "Could not set device %hu. Exit code: %d", device,
                      status);
     }
 }
@@ -244,7 +547,95 @@ void handle_cmd_fan_set_speed(packet_t *packet) {
     serial_info(SERIAL_SRC_GENERAL, "Set fan %d to %d", index, speed);
     pwm_set(index, speed);
 }
-void handle_cmd_fan_get_speed(packet_t *packet) {}
+void handle_cmd_fan_set_speeds(packet_t *packet) {
+    uint8_t count;
+    uint8_t indices[PWM_MAX_CHANNELS];
+    uint16_t speeds[PWM_MAX_CHANNELS];
+    if (packet->payload_length < 1 || packet->payload[0] > PWM_MAX_CHANNELS ||
+        packet->payload_length != 1 + 3 * packet->payload[0]) {
+        serial_error(SERIAL_SRC_GENERAL, "Invalid fan speeds packet.");
+        return;
+    }
+    decode_cmd_fan_set_speeds(packet, &count, indices, speeds);
+    for (uint8_t i = 0; i < count; i++) {
+        pwm_stage(indices[i], speeds[i]);
+    }
+    // all fans are written with a single transaction
+    pwm_flush();
+}
+void handle_cmd_pwm_ramp(packet_t *packet) {
+    uint8_t index;
+    uint16_t target;
+    uint32_t duration_ms;
+    uint8_t curve;
+    return_status_t status;
+    decode_cmd_pwm_ramp(packet, &index, &target, &duration_ms, &curve);
+    status = pwm_ramp(index, target, duration_ms, curve);
+    if (status != RET_SUCCESS) {
+        serial_error(SERIAL_SRC_GENERAL,
+                     "Could not ramp channel %d. Exit code: %d", index, status);
+    }
+}
+void handle_cmd_fan_control_set_levels(packet_t *packet) {
+    uint8_t count;
+    int16_t lows[FAN_CONTROL_MAX_LEVELS];
+    int16_t highs[FAN_CONTROL_MAX_LEVELS];
+    uint16_t pwms[FAN_CONTROL_MAX_LEVELS];
+    fan_control_level_t levels[FAN_CONTROL_MAX_LEVELS];
+    return_status_t status;
+    if (packet->payload_length < 1 ||
+        packet->payload[0] > FAN_CONTROL_MAX_LEVELS ||
+        packet->payload_length != 1 + 6 * packet->payload[0]) {
+        serial_error(SERIAL_SRC_GENERAL, "Invalid fan levels packet.");
+        return;
+    }
+    decode_cmd_fan_control_set_levels(packet, &count, lows, highs, pwms);
+    for (uint8_t i = 0; i < count; i++) {
+        levels[i].low = lows[i];
+        levels[i].high = highs[i];
+        levels[i].pwm = pwms[i];
+    }
+    status = fan_control_set_levels(levels, count);
+    if (status != RET_SUCCESS) {
+        serial_error(SERIAL_SRC_GENERAL,
+                     "Could not set fan levels. Exit code: %d", status);
+    }
+}
+void handle_cmd_fan_control_set_sensors(packet_t *packet) {
+    uint8_t count;
+    uint8_t roms[FAN_CONTROL_MAX_SENSORS][8];
+    if (packet->payload_length < 1 ||
+        packet->payload[0] > FAN_CONTROL_MAX_SENSORS ||
+        packet->payload_length != 1 + 8 * packet->payload[0]) {
+        serial_error(SERIAL_SRC_GENERAL, "Invalid fan sensors packet.");
+        return;
+    }
+    decode_cmd_fan_control_set_sensors(packet, &count, roms);
+    fan_control_set_sensors((const uint8_t(*)[8])roms, count);
+}
+void handle_cmd_fan_control_enable(packet_t *packet) {
+    uint8_t enabled;
+    uint16_t channels;
+    decode_cmd_fan_control_enable(packet, &enabled, &channels);
+    fan_control_enable(enabled, channels);
+}
+void handle_cmd_fan_control_get_state(packet_t *packet) {
+    uint8_t enabled, level;
+    int16_t temperature;
+    uint16_t pwm;
+    fan_control_get_state(&enabled, &level, &temperature, &pwm);
+    encode_response_fan_control_get_state(packet, enabled, level, temperature,
+                                          pwm);
+    serial_send_packet(packet);
+}
+void handle_cmd_fan_get_speed(packet_t *packet) {
+    uint8_t index;
+    uint16_t speed;
+    decode_cmd_fan_get_speed(packet, &index);
+    pwm_get(index, &speed);
+    encode_response_fan_get_speed(packet, index, speed);
+    serial_send_packet(packet);
+}
 void handle_cmd_unknown(packet_t *packet) {
     serial_warning(SERIAL_SRC_SERIAL, "Received unknown packet ID");
 }
@@ -0,0 +1,401 @@
+/**
+ * @file probe.c
+ * @brief Table of the EZO circuits of the controller.
+ *
+ * Each entry holds the type of a circuit, its I2C address or USART and the
+ * pin that powers it. The table is kept in EEPROM, so one controller serves
+ * several reservoirs without a rebuild. It is read at start-up and changes
+ * take effect after a reset, since the tasks of the circuits can not be
+ * removed from the scheduler. Each circuit has its own task, so commands to
+ * different circuits are processed at the same time.
+ *
+ * Packets address the circuits by their index in the table. The water sensors
+ * a circuit is compensated with are set in compensation.c by the same index.
+ *
+ * The EC and pH circuits speak the same protocol, so one reader serves both.
+ * They only differ in the decimals of a reading and in the calibration
+ * commands, which are looked up by type in @ref type_infos.
+ */
+#include "probe.h"
+
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/delay.h>
+
+#include "compensation.h"
+#include "fixed.h"
+#include "serial.h"
+#include "uart.h"
+
+#define EEPROM_MAGIC 0xA5
+
+#ifdef EC_UART
+#define DEFAULT_EC_UART EC_UART
+#else
+#define DEFAULT_EC_UART 0
+#endif
+#ifdef PH_UART
+#define DEFAULT_PH_UART PH_UART
+#else
+#define DEFAULT_PH_UART 0
+#endif
+
+/**
+ * @brief The single reservoir of a controller without a table in EEPROM.
+ * Building with `EC_UART` or `PH_UART` set to the number of a USART (1 to 3)
+ * drives the circuit in UART mode there, see ezo.h.
+ */
+static const probe_config_t default_table[] = {
+    {PROBE_TYPE_EC, 0x65, DEFAULT_EC_UART, 'J', 2},
+    {PROBE_TYPE_PH, 0x64, DEFAULT_PH_UART, 'H', 2},
+};
+
+/**
+ * @brief What sets the types of circuits apart. A calibration point without
+ * command is not supported by the type.
+ */
+typedef struct {
+    uint8_t decimals;  ///< Decimals of a reading.
+    const char *calibrations[PROBE_N_CALIBRATIONS];
+} probe_type_info_t;
+
+static const probe_type_info_t type_infos[] = {
+    [PROBE_TYPE_NONE] = {0, {NULL}},
+    [PROBE_TYPE_EC] = {0,
+                       {"Cal,clear", "Cal,dry", "Cal,low,12880", NULL,
+                        "Cal,high,80000"}},
+    [PROBE_TYPE_PH] = {3,
+                       {"Cal,clear", NULL, "Cal,low,4.00", "Cal,mid,7.00",
+                        "Cal,high,10.00"}},
+};
+
+static const char *const calibration_messages[PROBE_N_CALIBRATIONS] = {
+    "Calibration cleared.",       "Dry calibration done.",
+    "Lowpoint calibration done.", "Midpoint calibration done.",
+    "Highpoint calibration done.",
+};
+
+static probe_config_t table[PROBE_MAX_DEVICES];
+static ezo_t devices[PROBE_MAX_DEVICES];
+static int16_t compensations[PROBE_MAX_DEVICES];
+static probe_callback_t read_callbacks[PROBE_MAX_DEVICES];
+
+static uint8_t ee_magic EEMEM;
+static probe_config_t ee_table[PROBE_MAX_DEVICES] EEMEM;
+static ezo_calibration_t ee_calibrations[PROBE_MAX_DEVICES] EEMEM;
+
+static volatile uint8_t *probe_port(uint8_t letter) {
+    switch (letter) {
+        case 'A':
+            return &PORTA;
+        case 'B':
+            return &PORTB;
+        case 'C':
+            return &PORTC;
+        case 'D':
+            return &PORTD;
+        case 'E':
+            return &PORTE;
+        case 'F':
+            return &PORTF;
+        case 'G':
+            return &PORTG;
+        case 'H':
+            return &PORTH;
+        case 'J':
+            return &PORTJ;
+        case 'K':
+            return &PORTK;
+        case 'L':
+            return &PORTL;
+        default:
+            return NULL;
+    }
+}
+
+static void probe_load() {
+    if (eeprom_read_byte(&ee_magic) != EEPROM_MAGIC) {
+        memcpy(table, default_table, sizeof(default_table));
+        return;
+    }
+    eeprom_read_block(table, ee_table, sizeof(table));
+}
+
+/**
+ * @brief Power cycles all circuits at once.
+ */
+static void probe_power_cycle() {
+    volatile uint8_t *port;
+    uint8_t n_pins = 0;
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        port = probe_port(table[i].enable_port);
+        if (table[i].type == PROBE_TYPE_NONE || port == NULL) {
+            continue;
+        }
+        DDR_REGISTER(*port) |= (1 << table[i].enable_pin);
+        *port &= ~(1 << table[i].enable_pin);
+        n_pins++;
+    }
+    if (n_pins == 0) {
+        return;
+    }
+    _delay_ms(100);
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        port = probe_port(table[i].enable_port);
+        if (table[i].type != PROBE_TYPE_NONE && port != NULL) {
+            *port |= (1 << table[i].enable_pin);
+        }
+    }
+    _delay_ms(1000);
+}
+
+void probe_init() {
+    serial_log_source_t source;
+    probe_load();
+    probe_power_cycle();
+    for (uint8_t i = 0; i < PROBE_MAX_DEVICES; i++) {
+        if (table[i].type == PROBE_TYPE_NONE) {
+            continue;
+        }
+        source =
+            table[i].type == PROBE_TYPE_EC ? SERIAL_SRC_EC : SERIAL_SRC_PH;
+        if (table[i].uart_id) {
+            ezo_init_uart(&devices[i], table[i].uart_id, source);
+            serial_info(source, "Device %hu on USART%hu.", i,
+                        table[i].uart_id);
+        } else {
+            ezo_init(&devices[i], table[i].address, source);
+            serial_info(source, "Device %hu at address 0x%02x.", i,
+                        table[i].address);
+        }
+    }
+}
+
+/**
+ * @brief Changes entry @p index of the device table in EEPROM. The change
+ * takes effect after a reset.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_PROBE_INVALID_DEVICE if @p index is out of range.
+ * - @ref RET_PROBE_INVALID_CONFIG
+ */
+return_status_t probe_set_device(uint8_t index, const probe_config_t *config) {
+    if (index >= PROBE_MAX_DEVICES) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    if (config->type > PROBE_TYPE_PH || config->address > 0x7F ||
+        config->uart_id >= NO_OF_UARTS || config->enable_pin > 7 ||
+        (config->enable_port != 0 &&
+         probe_port(config->enable_port) == NULL)) {
+        return RET_PROBE_INVALID_CONFIG;
+    }
+#ifdef OWI_UART
+    // USART1 is used by the OWI bus
+    if (config->uart_id == 1) {
+        return RET_PROBE_INVALID_CONFIG;
+    }
+#endif
+    if (eeprom_read_byte(&ee_magic) != EEPROM_MAGIC) {
+        eeprom_update_block(table, ee_table, sizeof(table));
+    }
+    eeprom_update_block(config, &ee_table[index], sizeof(*config));
+    eeprom_update_byte(&ee_magic, EEPROM_MAGIC);
+    serial_info(SERIAL_SRC_GENERAL,
+                "Device %hu changed. The change takes effect after a reset.",
+                index);
+    return RET_SUCCESS;
+}
+
+probe_type_t probe_type(uint8_t index) {
+    if (index >= PROBE_MAX_DEVICES) {
+        return PROBE_TYPE_NONE;
+    }
+    return (probe_type_t)table[index].type;
+}
+
+/**
+ * @brief Looks up the circuit at @p index of the device table.
+ *
+ * @return ezo_t* `NULL` if there is no circuit of @p type at @p index.
+ */
+ezo_t *probe_device(uint8_t index, probe_type_t type) {
+    if (type == PROBE_TYPE_NONE || probe_type(index) != type) {
+        return NULL;
+    }
+    return &devices[index];
+}
+
+uint8_t probe_index(const ezo_t *ezo) { return ezo - devices; }
+
+static void probe_read_done(ezo_t *ezo, return_status_t status, char *data,
+                            void *context) {
+    uint8_t index = probe_index(ezo);
+    probe_callback_t callback = read_callbacks[index];
+    int32_t value = 0;
+    (void)context;
+    read_callbacks[index] = NULL;
+    if (status == RET_SUCCESS) {
+        status = fixed_parse(data, type_infos[table[index].type].decimals,
+                             &value);
+    }
+    callback(index, status, (uint32_t)value);
+}
+
+/**
+ * @brief Starts a reading of the circuit at @p index of the device table and
+ * returns immediately. @p callback is called with the reading once the
+ * circuit is done.
+ *
+ * The reading is compensated with the local water temperature if the mapped
+ * sensors have a recent reading, see compensation.c.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_PROBE_INVALID_DEVICE if there is no circuit of @p type at
+ *   @p index.
+ * - @ref RET_EZO_BUSY if a reading is already in progress.
+ * - @ref RET_EZO_QUEUE_FULL
+ */
+return_status_t probe_read(uint8_t index, probe_type_t type,
+                           probe_callback_t callback) {
+    return_status_t status;
+    int16_t temperature;
+    ezo_t *ezo = probe_device(index, type);
+    if (ezo == NULL) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    if (read_callbacks[index] != NULL) {
+        return RET_EZO_BUSY;
+    }
+    if (compensation_get(index, &temperature)) {
+        status = ezo_read_compensated(ezo, temperature, probe_read_done, NULL);
+    } else {
+        status = ezo_submit(ezo, "R", EZO_WAIT_READ_MS, probe_read_done, NULL);
+    }
+    ASSERT_SUCCESS(status);
+    read_callbacks[index] = callback;
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Calibrates the circuit at @p index to @p point. The result is
+ * logged once the circuit is done.
+ *
+ * @return Returns @ref RET_PROBE_INVALID_DEVICE if there is no circuit of
+ * @p type at @p index or the type does not support @p point and one of the
+ * exit codes of @ref ezo_submit() otherwise.
+ */
+return_status_t probe_calibrate(uint8_t index, probe_type_t type,
+                                probe_calibration_t point) {
+    const char *command;
+    ezo_t *ezo = probe_device(index, type);
+    if (ezo == NULL || point >= PROBE_N_CALIBRATIONS) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    command = type_infos[type].calibrations[point];
+    if (command == NULL) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    return ezo_submit(
+        ezo, command,
+        point == PROBE_CALIBRATION_CLEAR ? EZO_WAIT_GENERAL_MS
+                                         : EZO_WAIT_READ_MS,
+        ezo_log_done, (void *)calibration_messages[point]);
+}
+
+/**
+ * @brief Reads the calibration of the circuit into its EEPROM cache, see
+ * @ref ezo_export_calibration().
+ *
+ * @return Returns @ref RET_PROBE_INVALID_DEVICE if there is no circuit of
+ * @p type at @p index and one of the exit codes of @ref
+ * ezo_export_calibration() otherwise.
+ */
+return_status_t probe_calibration_export(uint8_t index, probe_type_t type,
+                                         ezo_calibration_callback_t callback) {
+    ezo_t *ezo = probe_device(index, type);
+    if (ezo == NULL) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    return ezo_export_calibration(ezo, &ee_calibrations[index], callback);
+}
+
+/**
+ * @brief Stores a chunk of a calibration sent by the host in the EEPROM cache
+ * of the circuit, see @ref ezo_import_calibration_chunk().
+ */
+return_status_t probe_calibration_import(uint8_t index, probe_type_t type,
+                                         uint8_t chunk, uint8_t n_chunks,
+                                         const uint8_t *data, uint8_t length,
+                                         ezo_calibration_callback_t callback) {
+    ezo_t *ezo = probe_device(index, type);
+    if (ezo == NULL) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    return ezo_import_calibration_chunk(ezo, &ee_calibrations[index], chunk,
+                                        n_chunks, data, length, callback);
+}
+
+/**
+ * @brief Imports the calibration in the EEPROM cache to the circuit, e.g.
+ * after its probe has been replaced.
+ */
+return_status_t probe_calibration_restore(uint8_t index, probe_type_t type,
+                                          ezo_calibration_callback_t callback) {
+    ezo_t *ezo = probe_device(index, type);
+    if (ezo == NULL) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    return ezo_import_calibration(ezo, &ee_calibrations[index], callback);
+}
+
+uint8_t probe_calibration_chunk(uint8_t index, uint8_t chunk, uint8_t *data,
+                                uint8_t *n_chunks) {
+    if (index >= PROBE_MAX_DEVICES) {
+        *n_chunks = 0;
+        return 0;
+    }
+    return ezo_calibration_chunk(&ee_calibrations[index], chunk, data,
+                                 n_chunks);
+}
+
+static void probe_compensation_done(ezo_t *ezo, return_status_t status,
+                                    char *data, void *context) {
+    char temperature[FIXED_MAX_STRING_LENGTH];
+    (void)data;
+    (void)context;
+    if (status != RET_SUCCESS) {
+        serial_error(ezo->source,
+                     "Could not set temperature compensation. Exit code. %d",
+                     status);
+        return;
+    }
+    fixed_format(temperature, compensations[probe_index(ezo)], 2);
+    serial_info(ezo->source, "Temperature compensation set to %s",
+                temperature);
+}
+
+/**
+ * @brief Sets the temperature compensation of the circuit.
+ *
+ * @param centi_degrees Temperature in 1/100 degree Celsius.
+ */
+return_status_t probe_temperature_compensation(uint8_t index,
+                                               probe_type_t type,
+                                               int16_t centi_degrees) {
+    char command[EZO_MAX_COMMAND_LENGTH] = "T,";
+    ezo_t *ezo = probe_device(index, type);
+    if (ezo == NULL) {
+        return RET_PROBE_INVALID_DEVICE;
+    }
+    compensations[index] = centi_degrees;
+    fixed_format(command + 2, centi_degrees, 2);
+    return ezo_submit(ezo, command, EZO_WAIT_READ_MS, probe_compensation_done,
+                      NULL);
+}
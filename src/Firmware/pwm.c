@@ -1,15 +1,23 @@
 #include "pwm.h"
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "common.h"
-#include "twi.h"
+#include "scheduler.h"
 #include "serial.h"
+#include "timer.h"
+#include "twi.h"
 
 #define TWI_ADDRESS 0x40
+// Fast-mode Plus, the TWI limits it to TWI_MAX_CLOCK_HZ
+#define TWI_CLOCK_HZ 1000000UL
 
 #define PWM_0_REG 0x06
 #define REG_PER_PWM 0x04
+#define PWM_CHANNELS PWM_MAX_CHANNELS
+#define ALL_LED_ON_L_REG 0xFA
 
 #define MODE1_REG 0x00
 #define MODE1_AI 0x05
@@ -18,39 +26,302 @@
 #define EN_PORT PORTE
 #define EN_PIN PE2
 
+/**
+ * @brief Off times of all channels as the PCA9685 has them after the pending
+ * flush. The on times are always 0.
+ *
+ * Channels are changed in the shadow copy first and marked in #dirty. A flush
+ * writes all dirty channels with a single auto incremented transaction, or
+ * through the ALL_LED registers if all channels are equal.
+ */
+static uint16_t shadow[PWM_CHANNELS];
+static uint16_t dirty = 0;
+static uint8_t flush_pending = false;
+/**
+ * @brief Channels written by the flush that is on the bus.
+ */
+static uint8_t flush_first;
+static uint8_t flush_last;
+static twi_transaction_t flush_transaction;
+static uint8_t flush_buffer[1 + REG_PER_PWM * PWM_CHANNELS];
+
+/**
+ * @brief A transition of a channel from #start to #target.
+ */
+typedef struct {
+    uint16_t start;
+    uint16_t target;
+    uint32_t start_ms;
+    uint32_t duration_ms;
+    pwm_curve_t curve;
+} pwm_ramp_t;
+
+static pwm_ramp_t ramps[PWM_CHANNELS];
+static uint16_t ramping = 0;
+static task_t pwm_task;
+
+static void pwm_flush_done(twi_transaction_t *transaction) {
+    if (transaction->status != RET_SUCCESS) {
+        serial_error(SERIAL_SRC_GENERAL,
+                     "Could not communicate with slave on address %x. Exit "
+                     "code: %d",
+                     TWI_ADDRESS, transaction->status);
+        // the PCA9685 still has the old values, write them again
+        for (uint8_t i = flush_first; i <= flush_last; i++) {
+            dirty |= (1U << i);
+        }
+        flush_pending = true;
+        // retry with the next tick instead of hammering the bus
+        scheduler_sleep(&pwm_task, PWM_RAMP_TICK_MS);
+        return;
+    }
+    if (flush_pending) {
+        pwm_flush();
+    }
+}
+
+static uint8_t pwm_all_equal() {
+    for (uint8_t i = 1; i < PWM_CHANNELS; i++) {
+        if (shadow[i] != shadow[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Puts the on and off registers of a channel with off time @p pwm
+ * into @p buffer.
+ */
+static uint8_t pwm_put_channel(uint8_t *buffer, uint16_t pwm) {
+    buffer[0] = 0;
+    buffer[1] = 0;
+    buffer[2] = LOWER_BYTE(pwm);
+    buffer[3] = UPPER_BYTE(pwm);
+    return REG_PER_PWM;
+}
+
+/**
+ * @brief Changes a channel in the shadow copy without touching its ramp.
+ */
+static void pwm_update(uint8_t index, uint16_t pwm) {
+    if (shadow[index] == pwm) {
+        return;
+    }
+    shadow[index] = pwm;
+    dirty |= (1U << index);
+}
+
+/**
+ * @brief Maps the linear progress @p x of a ramp to the progress of the
+ * output. Both are fractions of 2^16.
+ */
+static uint16_t pwm_curve(pwm_curve_t curve, uint16_t x) {
+    uint32_t x2 = ((uint32_t)x * x) >> 16;
+    uint32_t y;
+    switch (curve) {
+        case PWM_CURVE_QUADRATIC:
+            return x2;
+        case PWM_CURVE_EASE_IN_OUT:
+            // 3x^2 - 2x^3, rounding can exceed 1 just before the end
+            y = 3 * x2 - 2 * ((x2 * x) >> 16);
+            return y > 0xFFFF ? 0xFFFF : y;
+        default:
+            return x;
+    }
+}
+
+/**
+ * @brief Computes the current value of a ramp.
+ *
+ * @return uint8_t `true` if the ramp has reached its target.
+ */
+static uint8_t pwm_ramp_value(const pwm_ramp_t *ramp, uint16_t *pwm) {
+    uint32_t elapsed = timer_elapsed_ms(ramp->start_ms);
+    uint32_t duration = ramp->duration_ms;
+    uint16_t progress;
+    int32_t delta;
+    if (elapsed >= duration) {
+        *pwm = ramp->target;
+        return true;
+    }
+    // keep both below 2^16 so that the fraction does not overflow
+    while (duration > 0xFFFF) {
+        duration >>= 1;
+        elapsed >>= 1;
+    }
+    progress = pwm_curve(ramp->curve, (elapsed << 16) / duration);
+    delta = (int32_t)ramp->target - ramp->start;
+    // the product of two 16 bit magnitudes does not fit into an int32_t
+    *pwm = ramp->start + (((int64_t)delta * progress) >> 16);
+    return false;
+}
+
+/**
+ * @brief Advances all running ramps and writes them with a single flush.
+ */
+static void pwm_poll(task_t *task) {
+    uint16_t pwm;
+    for (uint8_t i = 0; i < PWM_CHANNELS; i++) {
+        if (!(ramping & (1U << i))) {
+            continue;
+        }
+        if (pwm_ramp_value(&ramps[i], &pwm)) {
+            ramping &= ~(1U << i);
+        }
+        pwm_update(i, pwm);
+    }
+    pwm_flush();
+    if (ramping) {
+        scheduler_sleep(task, PWM_RAMP_TICK_MS);
+    } else {
+        scheduler_suspend(task);
+    }
+}
+
 void pwm_init() {
+    twi_transaction_t transaction;
+    uint8_t mode[] = {MODE1_REG, (1 << MODE1_AI) | (1 << MODE1_ALLCALL)};
+    uint8_t reg = PWM_0_REG;
     DDR_REGISTER(EN_PORT) |= (1 << EN_PIN);
     EN_PORT &= ~(1 << EN_PIN);
     twi_init();
-    twi_start_write(TWI_ADDRESS);
-    twi_write_byte(MODE1_REG);
-    twi_write_byte((1 << MODE1_AI) | (1 << MODE1_ALLCALL));
-    twi_stop();
+    twi_register_device(TWI_ADDRESS, TWI_CLOCK_HZ);
+    twi_transaction_init(&transaction, TWI_ADDRESS, mode, sizeof(mode), NULL,
+                         0);
+    twi_transfer(&transaction);
+    // the shadow copy starts with what the PCA9685 currently outputs
+    twi_transaction_init(&transaction, TWI_ADDRESS, &reg, sizeof(reg),
+                         flush_buffer, REG_PER_PWM * PWM_CHANNELS);
+    if (twi_transfer(&transaction) == RET_SUCCESS) {
+        for (uint8_t i = 0; i < PWM_CHANNELS; i++) {
+            uint8_t *off = &flush_buffer[REG_PER_PWM * i + 2];
+            shadow[i] = (uint16_t)off[0] | (off[1] << 8);
+        }
+    }
+    twi_transaction_init(&flush_transaction, TWI_ADDRESS, flush_buffer, 0,
+                         NULL, 0);
+    flush_transaction.callback = pwm_flush_done;
+    scheduler_add(&pwm_task, pwm_poll);
+    scheduler_suspend(&pwm_task);
 }
 
-void pwm_set(uint8_t index, uint16_t pwm) {
-    uint8_t reg = PWM_0_REG + REG_PER_PWM * index;
-    // skip on regs
-    reg += 2;
-    if (twi_start_write(TWI_ADDRESS)) {
-        serial_error(SERIAL_SRC_GENERAL,
-                     "Could not communicate with slave on address %x",
-                     TWI_ADDRESS);
+/**
+ * @brief Changes the off time of channel @p index in the shadow copy and stops
+ * its ramp. The PCA9685 is written by the next @ref pwm_flush().
+ */
+void pwm_stage(uint8_t index, uint16_t pwm) {
+    if (index >= PWM_CHANNELS) {
+        return;
+    }
+    ramping &= ~(1U << index);
+    pwm_update(index, pwm);
+}
+
+/**
+ * @brief Queues one write of all channels changed by @ref pwm_stage() and
+ * returns immediately.
+ *
+ * If the previous flush is still on the bus, the write is queued once it is
+ * done. Channels staged until then are written with it.
+ */
+void pwm_flush() {
+    uint8_t first = 0;
+    uint8_t last = PWM_CHANNELS - 1;
+    uint8_t length = 1;
+    if (flush_transaction.status == RET_TWI_BUSY) {
+        flush_pending = true;
+        return;
+    }
+    flush_pending = false;
+    if (!dirty) {
+        return;
+    }
+    if (pwm_all_equal()) {
+        flush_buffer[0] = ALL_LED_ON_L_REG;
+        length += pwm_put_channel(&flush_buffer[length], shadow[0]);
+    } else {
+        while (!(dirty & (1U << first))) {
+            first++;
+        }
+        while (!(dirty & (1U << last))) {
+            last--;
+        }
+        // unchanged channels in between are rewritten to keep the burst
+        // contiguous
+        flush_buffer[0] = PWM_0_REG + REG_PER_PWM * first;
+        for (uint8_t i = first; i <= last; i++) {
+            length += pwm_put_channel(&flush_buffer[length], shadow[i]);
+        }
     }
-    twi_write_byte(reg);
-    twi_write_byte(LOWER_BYTE(pwm));
-    twi_write_byte(UPPER_BYTE(pwm));
-    twi_stop();
+    flush_first = first;
+    flush_last = last;
+    dirty = 0;
+    flush_transaction.write_length = length;
+    twi_submit(&flush_transaction);
 }
 
+/**
+ * @brief Sets the off time of channel @p index and flushes it immediately.
+ */
+void pwm_set(uint8_t index, uint16_t pwm) {
+    pwm_stage(index, pwm);
+    pwm_flush();
+}
+
+/**
+ * @brief Gets the off time of channel @p index from the shadow copy.
+ */
 void pwm_get(uint8_t index, uint16_t *pwm) {
-    uint8_t buffer[sizeof(*pwm)];
-    uint8_t reg = PWM_0_REG + REG_PER_PWM * index;
-    reg += 2;
-    twi_start_write(TWI_ADDRESS);
-    twi_write_byte(reg);
-    twi_start_read(TWI_ADDRESS);
-    twi_read(buffer, sizeof(*pwm));
-    twi_stop();
-    *pwm = (uint16_t)buffer[0] | (buffer[1] << 8);
-}
\ No newline at end of file
+    *pwm = index < PWM_CHANNELS ? shadow[index] : 0;
+}
+
+/**
+ * @brief Ramps channel @p index from its current value to @p target within
+ * @p duration_ms and returns immediately.
+ *
+ * The channel is updated every #PWM_RAMP_TICK_MS. Ramps of all channels that
+ * are due in the same tick are written with a single transaction. A running
+ * ramp of the channel is replaced, @ref pwm_set() stops it.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_PWM_INVALID_CHANNEL
+ * - @ref RET_PWM_INVALID_CURVE
+ * - @ref RET_PWM_INVALID_VALUE if @p target is above #PWM_MAX_VALUE.
+ */
+return_status_t pwm_ramp(uint8_t index, uint16_t target, uint32_t duration_ms,
+                         pwm_curve_t curve) {
+    pwm_ramp_t *ramp;
+    if (index >= PWM_CHANNELS) {
+        return RET_PWM_INVALID_CHANNEL;
+    }
+    if (curve > PWM_CURVE_QUADRATIC) {
+        return RET_PWM_INVALID_CURVE;
+    }
+    if (target > PWM_MAX_VALUE) {
+        return RET_PWM_INVALID_VALUE;
+    }
+    ramp = &ramps[index];
+    if (ramping & (1U << index)) {
+        // a running ramp continues from where it is now
+        pwm_ramp_value(ramp, &ramp->start);
+    } else {
+        ramp->start = shadow[index];
+    }
+    ramp->target = target;
+    ramp->start_ms = timer_now_ms();
+    ramp->duration_ms = duration_ms;
+    ramp->curve = curve;
+    ramping |= (1U << index);
+    scheduler_resume(&pwm_task);
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Checks whether channel @p index is ramping.
+ */
+uint8_t pwm_ramping(uint8_t index) {
+    return index < PWM_CHANNELS && (ramping & (1U << index));
+}
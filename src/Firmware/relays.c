@@ -1,9 +1,9 @@
 #include "relays.h"
 
 #include <avr/io.h>
-#include <util/delay.h>
 
 #include "common.h"
+#include "scheduler.h"
 
 #define RELAYS_PORT PORTA
 
@@ -11,43 +11,73 @@
 #define LED_BLUE_PIN PA1
 #define LED_WHITE_PIN PA2
 
+// relays are switched on one after another to spread the inrush current
+#define SWITCH_ON_GAP_MS 100
+
+static task_t relays_task;
+static uint8_t pending_on = 0;
+
+static uint8_t relays_pin_mask(RELAYS_COLOR_t color) {
+    switch (color) {
+        case RELAYS_RED:
+            return (1 << LED_RED_PIN);
+        case RELAYS_BLUE:
+            return (1 << LED_BLUE_PIN);
+        case RELAYS_WHITE:
+            return (1 << LED_WHITE_PIN);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Switches on one pending relay per #SWITCH_ON_GAP_MS.
+ */
+static void relays_poll(task_t *task) {
+    uint8_t mask;
+    if (!pending_on) {
+        scheduler_suspend(task);
+        return;
+    }
+    // lowest pending bit first
+    mask = pending_on & (uint8_t)(-pending_on);
+    pending_on &= ~mask;
+    RELAYS_PORT &= ~mask;
+    scheduler_sleep(task, SWITCH_ON_GAP_MS);
+}
+
 void relays_init() {
     DDR_REGISTER(RELAYS_PORT) = 0xFF;
 
     relays_all_off();
+    scheduler_add(&relays_task, relays_poll);
 }
 
-void relays_all_on() { RELAYS_PORT = 0x00; }
+void relays_all_on() {
+    pending_on = 0;
+    RELAYS_PORT = 0x00;
+}
 
-void relays_all_off() { RELAYS_PORT = 0xFF; }
+void relays_all_off() {
+    pending_on = 0;
+    RELAYS_PORT = 0xFF;
+}
 
+/**
+ * @brief Queues switching on the relay of @p color.
+ *
+ * The relay task switches it on as soon as the previous relay has been on for
+ * #SWITCH_ON_GAP_MS.
+ */
 void relays_on(RELAYS_COLOR_t color) {
-    switch (color) {
-        case RELAYS_RED:
-            RELAYS_PORT &= ~(1 << LED_RED_PIN);
-            break;
-        case RELAYS_BLUE:
-            RELAYS_PORT &= ~(1 << LED_BLUE_PIN);
-            break;
-        case RELAYS_WHITE:
-            RELAYS_PORT &= ~(1 << LED_WHITE_PIN);
-            break;
-    }
-    _delay_ms(100);
+    pending_on |= relays_pin_mask(color);
+    scheduler_resume(&relays_task);
 }
 
 void relays_off(RELAYS_COLOR_t color) {
-    switch (color) {
-        case RELAYS_RED:
-            RELAYS_PORT |= (1 << LED_RED_PIN);
-            break;
-        case RELAYS_BLUE:
-            RELAYS_PORT |= (1 << LED_BLUE_PIN);
-            break;
-        case RELAYS_WHITE:
-            RELAYS_PORT |= (1 << LED_WHITE_PIN);
-            break;
-    }
+    uint8_t mask = relays_pin_mask(color);
+    pending_on &= ~mask;
+    RELAYS_PORT |= mask;
 }
 
 void relays_set(RELAYS_COLOR_t color, uint8_t state) {
@@ -0,0 +1,82 @@
+/**
+ * @file scheduler.c
+ * @brief Cooperative round robin scheduler on top of the @ref timer.h
+ * timebase.
+ *
+ * Modules register their tasks during initialization. Slow operations are
+ * split into short steps so that several sensor transactions can be in flight
+ * while the communication task keeps serving commands.
+ */
+#include "scheduler.h"
+
+#include <stdlib.h>
+
+#include "timer.h"
+
+static task_t *tasks[SCHEDULER_MAX_TASKS];
+static uint8_t n_tasks = 0;
+
+/**
+ * @brief Adds @p task to the run queue. It is due immediately.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_SCHEDULER_FULL if #SCHEDULER_MAX_TASKS tasks are registered.
+ */
+return_status_t scheduler_add(task_t *task, void (*poll)(task_t *task)) {
+    if (n_tasks >= SCHEDULER_MAX_TASKS) {
+        return RET_SCHEDULER_FULL;
+    }
+    task->poll = poll;
+    task->next_due = timer_now_ms();
+    task->active = 1;
+    tasks[n_tasks++] = task;
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Polls @p task again after @p ms milliseconds.
+ */
+void scheduler_sleep(task_t *task, uint32_t ms) {
+    task->next_due = timer_deadline_ms(ms);
+    task->active = 1;
+}
+
+/**
+ * @brief Makes @p task due immediately, even if it is sleeping.
+ */
+void scheduler_wake(task_t *task) {
+    task->next_due = timer_now_ms();
+    task->active = 1;
+}
+
+/**
+ * @brief Stops polling @p task until it is woken or resumed.
+ */
+void scheduler_suspend(task_t *task) { task->active = 0; }
+
+/**
+ * @brief Makes a suspended @p task due immediately. A sleeping task keeps its
+ * due time.
+ */
+void scheduler_resume(task_t *task) {
+    if (!task->active) {
+        scheduler_wake(task);
+    }
+}
+
+/**
+ * @brief Runs the tasks forever.
+ */
+void scheduler_run() {
+    task_t *task;
+    while (1) {
+        for (uint8_t i = 0; i < n_tasks; i++) {
+            task = tasks[i];
+            if (task->active && timer_expired(task->next_due)) {
+                task->poll(task);
+            }
+        }
+    }
+}
@@ -18,10 +18,27 @@
 #define LOG_MAX_LEN (256 - 64)
 #define BAUD 250000
 #define SERIAL_RX_BUFFER_SIZE 256
+#define SERIAL_RX_FRAMES 2
 
 static uint8_t serial_initialized = 0;
 static uint8_t log_level = SERIAL_LOG_LVL_INFO;
 
+/**
+ * @brief Double buffered COBS frames assembled by the UART0 receive ISR.
+ *
+ * The ISR fills @ref rx_frames[rx_write_frame] and hands it over by setting
+ * its ready flag when the delimiter arrives. The main loop decodes the other
+ * frame meanwhile and clears the flag once it is done with it.
+ */
+static volatile uint8_t rx_frames[SERIAL_RX_FRAMES][SERIAL_RX_BUFFER_SIZE];
+static volatile uint8_t rx_frame_ready[SERIAL_RX_FRAMES];
+static volatile uint8_t rx_write_frame = 0;
+static volatile uint8_t rx_fill = 0;
+static volatile uint8_t rx_discard = 0;
+static volatile uint8_t rx_dropped_frames = 0;
+static uint8_t rx_read_frame = 0;
+static uint8_t rx_dropped_frames_reported = 0;
+
 static const char *_get_level_string(serial_log_level_t level) {
     switch (level) {
         case SERIAL_LOG_LVL_DEBUG:
@@ -79,9 +96,53 @@ static void _log(serial_log_level_t level, serial_log_source_t source,
     serial_send_packet(&packet);
 }
 
+/**
+ * @brief UART0 receive callback that runs in interrupt context.
+ *
+ * Frames longer than the buffer and frames arriving while both buffers are
+ * still owned by the main loop are dropped up to the next delimiter.
+ */
+static void _receive_byte(char c) {
+    uint8_t byte = (uint8_t)c;
+    uint8_t frame = rx_write_frame;
+
+    if (rx_discard) {
+        if (byte == 0) {
+            rx_discard = 0;
+        }
+        return;
+    }
+
+    if (rx_frame_ready[frame]) {
+        rx_dropped_frames++;
+        rx_discard = (byte != 0);
+        return;
+    }
+
+    if (byte != 0 && rx_fill == SERIAL_RX_BUFFER_SIZE - 1) {
+        rx_dropped_frames++;
+        rx_discard = 1;
+        rx_fill = 0;
+        return;
+    }
+
+    rx_frames[frame][rx_fill] = byte;
+    if (byte == 0) {
+        // ignore empty frames, e.g. back to back delimiters
+        if (rx_fill) {
+            rx_frame_ready[frame] = 1;
+            rx_write_frame = frame ^ 1;
+        }
+        rx_fill = 0;
+        return;
+    }
+    rx_fill++;
+}
+
 void serial_init() {
     if (!serial_initialized) {
         uart_init(0, BAUD);
+        uart_0_set_receive_callback(_receive_byte);
         serial_initialized = 1;
         serial_info(SERIAL_SRC_SERIAL, "Init complete.");
 
@@ -91,9 +152,8 @@ void serial_init() {
     }
 }
 
-void serial_send_raw(uint8_t *data) {
-    uart_0_puts((char *)data);
-    uart_0_putc('\0');
+void serial_send_raw(uint8_t *data, uint8_t length) {
+    uart_0_write(data, length);
 }
 
 void serial_send_packet(packet_t *packet) {
@@ -102,7 +162,7 @@ void serial_send_packet(packet_t *packet) {
     uint8_t length;
     length = packet_serialize(packet, serialized_data);
     length = cobs_encode(serialized_data, encoded_data, length);
-    serial_send_raw(encoded_data);
+    serial_send_raw(encoded_data, length);
 }
 
 void serial_debug(serial_log_source_t source, const char *format, ...) {
@@ -151,33 +211,59 @@ static void _write_payload(const uint8_t *src, uint8_t *dst, uint8_t length) {
     }
 }
 
-uint8_t serial_read_raw(uint8_t *data) {
-    uint8_t i = 0;
-    while (1) {
-        data[i] = uart_0_getc();
-        if (data[i] == 0) {
-            serial_debug(SERIAL_SRC_SERIAL, "Received packet frame.");
-            i = cobs_decode(data, data);
-            return i;
-        }
-        i++;
-        if (i == 0) {
-            serial_warning(SERIAL_SRC_SERIAL, "Receive buffer overflow,");
-        }
-    }
-}
+/**
+ * @brief Checks whether the receive ISR has completed a frame that has not been
+ * consumed yet.
+ */
+uint8_t serial_packet_available() { return rx_frame_ready[rx_read_frame]; }
 
-void serial_read_packet(packet_t *packet) {
+/**
+ * @brief Decodes the oldest completely received frame into @p packet without
+ * waiting for new data.
+ *
+ * @param[out] packet
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS if a valid packet was decoded.
+ * - @ref RET_SERIAL_NO_PACKET if no complete frame is pending.
+ * - Return value of @ref packet_deserialize() if the frame was invalid. The
+ * frame is discarded in this case.
+ */
+return_status_t serial_poll_packet(packet_t *packet) {
+    uint8_t frame = rx_read_frame;
+    uint8_t *data;
     uint8_t length;
+    uint8_t dropped;
     return_status_t status;
-    uint8_t receive_buffer[255];
-    while (1) {
-        length = serial_read_raw(receive_buffer);
-        status = packet_deserialize(packet, receive_buffer, length);
-        if (status == RET_SUCCESS) {
-            serial_info(SERIAL_SRC_SERIAL, "Received valid packet with ID %hu",
-                        packet->id);
-            return;
-        }
+
+    dropped = rx_dropped_frames;
+    if (dropped != rx_dropped_frames_reported) {
+        serial_warning(SERIAL_SRC_SERIAL, "Dropped %hu receive frame(s).",
+                       (uint8_t)(dropped - rx_dropped_frames_reported));
+        rx_dropped_frames_reported = dropped;
+    }
+
+    if (!rx_frame_ready[frame]) {
+        return RET_SERIAL_NO_PACKET;
+    }
+
+    // the ISR does not touch a frame while its ready flag is set
+    data = (uint8_t *)rx_frames[frame];
+    serial_debug(SERIAL_SRC_SERIAL, "Received packet frame.");
+    length = cobs_decode(data, data);
+    status = packet_deserialize(packet, data, length);
+
+    rx_read_frame = frame ^ 1;
+    rx_frame_ready[frame] = 0;
+
+    if (status == RET_SUCCESS) {
+        serial_info(SERIAL_SRC_SERIAL, "Received valid packet with ID %hu",
+                    packet->id);
     }
+    return status;
+}
+
+void serial_read_packet(packet_t *packet) {
+    while (serial_poll_packet(packet) != RET_SUCCESS)
+        ;
 }
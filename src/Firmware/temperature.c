@@ -0,0 +1,969 @@
+/**
+ * @file temperature.c
+ * @brief Non-blocking DS18B20 measurements on top of the OWI driver.
+ *
+ * A measurement is a small state machine run by its own task: the broadcast
+ * conversion is started, the bus is polled until the sensors report that they
+ * are done and then one device is enumerated and read per poll. This module is
+ * the only user of the bus while a measurement is in progress.
+ *
+ * The bus may consist of several lines on the same port. Conversions run on
+ * all lines at once and each read addresses one sensor on every line in
+ * lockstep, so spreading the sensors over more lines shortens a measurement.
+ * The search only works line by line.
+ *
+ * The devices on the bus are kept in a table that is filled by a ROM search
+ * only when needed: at boot if the table persisted in EEPROM cannot be
+ * verified, periodically to pick up new sensors and after a sensor stopped
+ * answering. Measurements address each sensor directly with MATCH ROM, so
+ * their cost does not include the search.
+ *
+ * In alarm mode only the sensors whose alarm flag has been set by the
+ * conversion are found by an ALARM SEARCH and read, so checking whether any
+ * sensor is outside of its band costs little more than the conversion.
+ *
+ * Every reading is stored in the table together with its timestamp. With a
+ * sampling period set, measurements run back to back in the background and
+ * requests are answered from the table as long as it is fresh enough.
+ *
+ * Each sensor has a resolution profile. The sensors of a measurement are
+ * grouped by resolution and each group is read as soon as its conversion
+ * time has passed. While slower groups are still converting, a faster group
+ * is converted and read again if the sampling period asks for it, so for
+ * example 9 bit heatsink sensors are sampled every 100 ms while 12 bit water
+ * sensors take 800 ms. An adaptive sensor drops to 9 bit while its reading
+ * is stable and returns to its profile as soon as the reading changes.
+ */
+#include "temperature.h"
+
+#include <avr/eeprom.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scheduler.h"
+#include "serial.h"
+#include "timer.h"
+
+#define CONVERSION_POLL_INTERVAL_MS 10
+#define READ_POLL_INTERVAL_MS 2
+#define ENUMERATION_PERIOD_MS (10UL * 60UL * 1000UL)
+#define EEPROM_MAGIC 0xA5
+#define ROM_SIZE 8
+/**
+ * @brief Readings in a row that stay within #ADAPTIVE_STEP before an adaptive
+ * sensor drops to 9 bit.
+ */
+#define ADAPTIVE_STABLE_READINGS 5
+// one 9 bit step of 0.5 degree Celsius
+#define ADAPTIVE_STEP 8
+
+#if TEMPERATURE_MAX_DEVICES > 16
+#error "temperature_table_update() tracks the table in 16 bit masks"
+#endif
+
+typedef enum {
+    TEMPERATURE_IDLE,
+    TEMPERATURE_ENUMERATING,
+    TEMPERATURE_CONVERTING,
+    TEMPERATURE_READING,
+    TEMPERATURE_COLLECTING,
+    TEMPERATURE_ALARM_SEARCHING
+} temperature_state_t;
+
+static task_t temperature_task;
+static temperature_state_t state = TEMPERATURE_IDLE;
+static temperature_callback_t measure_callback = NULL;
+static temperature_callback_t sample_listener = NULL;
+static temperature_alarms_callback_t alarms_callback = NULL;
+static uint8_t alarm_mode = false;
+static owi_bus_t *bus;
+static uint8_t n_read;
+/**
+ * @brief Index of the next sensor to be read on each line.
+ */
+static uint8_t read_round;
+static ds18b20_t *round_devices[OWI_MAX_LINES];
+static temperature_sample_t *round_samples[OWI_MAX_LINES];
+/**
+ * @brief Resolution each sensor converts with during the current measurement.
+ */
+static owi_resolution_t cycle_resolutions[TEMPERATURE_MAX_DEVICES];
+/**
+ * @brief Masks of the resolution groups that are still converting and of
+ * those that have been converted again, indexed by @ref owi_resolution_t.
+ */
+static uint8_t pending_groups;
+static uint8_t repeated_groups;
+static uint32_t group_deadlines[OWI_N_RESOLUTIONS];
+static owi_resolution_t read_group;
+
+static temperature_sample_t cache[TEMPERATURE_MAX_DEVICES];
+static uint8_t n_cached = 0;
+
+static uint8_t table_valid = false;
+static uint32_t enumerated_ms;
+static uint8_t found_roms[TEMPERATURE_MAX_DEVICES][ROM_SIZE];
+static uint8_t found_lines[TEMPERATURE_MAX_DEVICES];
+static uint8_t n_found;
+/**
+ * @brief The line that is currently searched and its search state.
+ */
+static owi_bus_t search_line;
+static uint8_t search_pin;
+static uint8_t search_started;
+
+static uint8_t ee_magic EEMEM;
+static uint8_t ee_count EEMEM;
+static uint8_t ee_roms[TEMPERATURE_MAX_DEVICES][ROM_SIZE] EEMEM;
+static uint8_t ee_lines[TEMPERATURE_MAX_DEVICES] EEMEM;
+static uint8_t ee_adaptive[TEMPERATURE_MAX_DEVICES] EEMEM;
+
+/**
+ * @brief Time between the start of two background measurements. 0 disables
+ * background sampling.
+ */
+static uint32_t sampling_period_ms = 0;
+/**
+ * @brief Maximum age of a cached reading to be reported without measuring. 0
+ * disables answering from the cache.
+ */
+static uint32_t max_age_ms = 0;
+static uint32_t cycle_start_ms;
+
+static uint8_t temperature_line_valid(uint8_t line) {
+    return line < OWI_MAX_LINES && (bus->pins & (1 << line));
+}
+
+static void temperature_search_reset() {
+    search_pin = 0;
+    search_started = false;
+}
+
+/**
+ * @brief Reads the resolution of a sensor that has just been added to the
+ * table and takes it as its profile.
+ */
+static void temperature_load_profile(temperature_sample_t *sample) {
+    owi_bus_t line;
+    owi_line(bus, sample->line, &line);
+    if (owi_read_config(&line, &sample->device) != RET_SUCCESS) {
+        // assume the factory default, the next reading corrects it
+        sample->device.resolution = OWI_RES_12;
+    }
+    sample->resolution = sample->device.resolution;
+    sample->n_stable = 0;
+}
+
+/**
+ * @brief Resolution @p sample should convert with in the next measurement.
+ */
+static owi_resolution_t temperature_target_resolution(
+    const temperature_sample_t *sample) {
+    if (sample->adaptive && sample->n_stable >= ADAPTIVE_STABLE_READINGS) {
+        return OWI_RES_9;
+    }
+    return sample->resolution;
+}
+
+/**
+ * @brief Tracks whether the reading of an adaptive sensor is stable.
+ */
+static void temperature_adapt(temperature_sample_t *sample) {
+    int16_t change;
+    if (!sample->adaptive) {
+        return;
+    }
+    change = (int16_t)(sample->device.temperature - sample->reference);
+    if (abs(change) < ADAPTIVE_STEP) {
+        if (sample->n_stable < ADAPTIVE_STABLE_READINGS) {
+            sample->n_stable++;
+        }
+        return;
+    }
+    sample->reference = sample->device.temperature;
+    sample->n_stable = 0;
+}
+
+/**
+ * @brief Hands a new reading to the listener and to the callback of the
+ * running measurement.
+ */
+static void temperature_publish(temperature_sample_t *sample) {
+    temperature_adapt(sample);
+    n_read++;
+    if (sample_listener != NULL) {
+        sample_listener(sample);
+    }
+    if (measure_callback != NULL) {
+        measure_callback(sample);
+    }
+}
+
+/**
+ * @brief Writes the resolution each sensor should convert with to its
+ * scratchpad if it differs from the current one.
+ */
+static void temperature_apply_profiles() {
+    owi_bus_t line;
+    owi_resolution_t resolution;
+    return_status_t status;
+    for (uint8_t i = 0; i < n_cached; i++) {
+        resolution = temperature_target_resolution(&cache[i]);
+        if (cache[i].device.resolution == resolution) {
+            continue;
+        }
+        owi_line(bus, cache[i].line, &line);
+        status = owi_write_resolution(&line, &cache[i].device, resolution);
+        if (status != RET_SUCCESS) {
+            serial_warning(SERIAL_SRC_OWI,
+                           "Could not change the resolution of sensor %hu. "
+                           "Exit code: %d",
+                           i, status);
+        }
+    }
+}
+
+static temperature_sample_t *temperature_lookup(const uint8_t *rom) {
+    for (uint8_t i = 0; i < n_cached; i++) {
+        if (memcmp(cache[i].device.rom, rom, ROM_SIZE) == 0) {
+            return &cache[i];
+        }
+    }
+    return NULL;
+}
+
+static void temperature_table_load() {
+    uint8_t count;
+    if (eeprom_read_byte(&ee_magic) != EEPROM_MAGIC) {
+        return;
+    }
+    count = eeprom_read_byte(&ee_count);
+    if (count > TEMPERATURE_MAX_DEVICES) {
+        return;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        eeprom_read_block(cache[i].device.rom, ee_roms[i], ROM_SIZE);
+        cache[i].line = eeprom_read_byte(&ee_lines[i]);
+        cache[i].adaptive = (eeprom_read_byte(&ee_adaptive[i]) == true);
+        cache[i].n_stable = 0;
+        cache[i].device.available = false;
+        // the table was stored with a different wiring
+        if (!temperature_line_valid(cache[i].line)) {
+            return;
+        }
+    }
+    n_cached = count;
+}
+
+static void temperature_table_store() {
+    for (uint8_t i = 0; i < n_cached; i++) {
+        eeprom_update_block(cache[i].device.rom, ee_roms[i], ROM_SIZE);
+        eeprom_update_byte(&ee_lines[i], cache[i].line);
+        eeprom_update_byte(&ee_adaptive[i], cache[i].adaptive);
+    }
+    eeprom_update_byte(&ee_count, n_cached);
+    eeprom_update_byte(&ee_magic, EEPROM_MAGIC);
+}
+
+/**
+ * @brief Replaces the device table by the ROMs found during the enumeration.
+ *
+ * Readings of devices that are still present are kept. The table is updated
+ * in place to keep a copy of it off the stack.
+ */
+static void temperature_table_update() {
+    // bit i marks cache[i] as still on the bus or found_roms[i] as known
+    uint16_t kept = 0;
+    uint16_t known = 0;
+    uint8_t n_kept = 0;
+    uint8_t changed = (n_found != n_cached);
+
+    for (uint8_t i = 0; i < n_cached; i++) {
+        for (uint8_t j = 0; j < n_found; j++) {
+            if (!(known & (1U << j)) &&
+                memcmp(cache[i].device.rom, found_roms[j], ROM_SIZE) == 0 &&
+                cache[i].line == found_lines[j]) {
+                kept |= (1U << i);
+                known |= (1U << j);
+                break;
+            }
+        }
+    }
+    // compact the sensors that are still there, then append the new ones
+    for (uint8_t i = 0; i < n_cached; i++) {
+        if (!(kept & (1U << i))) {
+            continue;
+        }
+        if (i != n_kept) {
+            cache[n_kept] = cache[i];
+        }
+        n_kept++;
+    }
+    n_cached = n_kept;
+    for (uint8_t j = 0; j < n_found; j++) {
+        if (known & (1U << j)) {
+            continue;
+        }
+        memcpy(cache[n_cached].device.rom, found_roms[j], ROM_SIZE);
+        cache[n_cached].line = found_lines[j];
+        cache[n_cached].device.available = false;
+        cache[n_cached].adaptive = false;
+        temperature_load_profile(&cache[n_cached]);
+        changed = true;
+        n_cached++;
+    }
+    // an empty bus is searched again with every cycle
+    table_valid = (n_cached > 0);
+    enumerated_ms = timer_now_ms();
+    if (changed) {
+        serial_info(SERIAL_SRC_OWI, "Found %hu temperature sensors.",
+                    n_cached);
+        temperature_table_store();
+    }
+}
+
+static return_status_t temperature_convert() {
+    return_status_t status;
+    owi_resolution_t resolution;
+    temperature_apply_profiles();
+    status = owi_start_conversion(bus);
+    ASSERT_SUCCESS(status);
+    n_read = 0;
+    pending_groups = 0;
+    repeated_groups = 0;
+    for (uint8_t i = 0; i < n_cached; i++) {
+        resolution = cache[i].device.resolution;
+        cycle_resolutions[i] = resolution;
+        pending_groups |= (1 << resolution);
+        group_deadlines[resolution] =
+            bus->conversion_start_ms + owi_conversion_time_ms(resolution);
+    }
+    state = TEMPERATURE_CONVERTING;
+    scheduler_sleep(&temperature_task, CONVERSION_POLL_INTERVAL_MS);
+    return RET_SUCCESS;
+}
+
+static return_status_t temperature_start() {
+    cycle_start_ms = timer_now_ms();
+    if (!table_valid ||
+        timer_elapsed_ms(enumerated_ms) >= ENUMERATION_PERIOD_MS) {
+        n_found = 0;
+        temperature_search_reset();
+        state = TEMPERATURE_ENUMERATING;
+        scheduler_wake(&temperature_task);
+        return RET_SUCCESS;
+    }
+    return temperature_convert();
+}
+
+/**
+ * @brief Schedules the next background cycle or stops the task.
+ */
+static void temperature_schedule_next() {
+    uint32_t elapsed;
+    if (!sampling_period_ms) {
+        scheduler_suspend(&temperature_task);
+        return;
+    }
+    elapsed = timer_elapsed_ms(cycle_start_ms);
+    if (elapsed >= sampling_period_ms) {
+        scheduler_wake(&temperature_task);
+    } else {
+        scheduler_sleep(&temperature_task, sampling_period_ms - elapsed);
+    }
+}
+
+static void temperature_finish(return_status_t status) {
+    if (status != RET_SUCCESS) {
+        serial_error(SERIAL_SRC_OWI,
+                     "Could not measure temperature. Exit code: %d", status);
+    }
+    serial_debug(SERIAL_SRC_OWI, "Read temperature from %d devices", n_read);
+    if (alarm_mode && alarms_callback != NULL) {
+        alarms_callback(n_read);
+    }
+    state = TEMPERATURE_IDLE;
+    measure_callback = NULL;
+    alarms_callback = NULL;
+    alarm_mode = false;
+    temperature_schedule_next();
+}
+
+/**
+ * @brief Skips to the next line of the bus that has not been searched yet.
+ *
+ * @return uint8_t `false` if all lines have been searched.
+ */
+static uint8_t temperature_next_line() {
+    while (search_pin < OWI_MAX_LINES && !temperature_line_valid(search_pin)) {
+        search_pin++;
+    }
+    return search_pin < OWI_MAX_LINES;
+}
+
+/**
+ * @brief Performs one step of a search that runs over all lines one after
+ * the other.
+ *
+ * A line without any sensor taking part is not an error.
+ *
+ * @param alarm_only Run an ALARM SEARCH instead of a ROM search.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS if a ROM was found. It is buffered in #search_line.
+ * - @ref RET_OWI_BUSY if the step did not find a ROM, but the search goes on.
+ * - @ref RET_OWI_SEARCH_LAST_DEVICE if all lines have been searched.
+ * - Other return values of @ref owi_search()
+ */
+static return_status_t temperature_search_step(uint8_t alarm_only) {
+    return_status_t status;
+    if (search_started) {
+        status = alarm_only ? owi_alarm_search_next(&search_line)
+                            : owi_search_next(&search_line);
+    } else if (temperature_next_line()) {
+        owi_line(bus, search_pin, &search_line);
+        search_started = true;
+        status = alarm_only ? owi_alarm_search_first(&search_line)
+                            : owi_search_first(&search_line);
+    } else {
+        return RET_OWI_SEARCH_LAST_DEVICE;
+    }
+    if (status == RET_OWI_SEARCH_LAST_DEVICE || status == RET_OWI_NO_PRESENCE) {
+        search_pin++;
+        search_started = false;
+        return RET_OWI_BUSY;
+    }
+    return status;
+}
+
+/**
+ * @brief Performs one step of the ROM search.
+ */
+static void temperature_enumerate_next() {
+    return_status_t status = temperature_search_step(false);
+    if (status == RET_OWI_BUSY) {
+        return;
+    }
+    if (status == RET_SUCCESS && n_found < TEMPERATURE_MAX_DEVICES) {
+        owi_get_buffered_rom(&search_line, found_roms[n_found]);
+        found_lines[n_found++] = search_pin;
+        return;
+    }
+    if (status == RET_SUCCESS) {
+        serial_warning(SERIAL_SRC_OWI, "More than %d sensors on the bus.",
+                       TEMPERATURE_MAX_DEVICES);
+    } else if (status != RET_OWI_SEARCH_LAST_DEVICE) {
+        // keep the old table and retry with the next cycle
+        temperature_finish(status);
+        return;
+    }
+    temperature_table_update();
+    status = temperature_convert();
+    if (status != RET_SUCCESS) {
+        temperature_finish(status);
+    }
+}
+
+/**
+ * @brief Finds the next alarming sensor and reads it.
+ */
+static void temperature_alarm_next() {
+    return_status_t status;
+    temperature_sample_t *sample;
+    temperature_sample_t unknown;
+    uint8_t rom[ROM_SIZE];
+
+    status = temperature_search_step(true);
+    if (status == RET_OWI_BUSY) {
+        return;
+    }
+    if (status != RET_SUCCESS) {
+        temperature_finish(status == RET_OWI_SEARCH_LAST_DEVICE ? RET_SUCCESS
+                                                                : status);
+        return;
+    }
+    owi_get_buffered_rom(&search_line, rom);
+    sample = temperature_lookup(rom);
+    if (sample == NULL) {
+        // report it anyway and pick it up with the next regular cycle
+        table_valid = false;
+        memset(&unknown, 0, sizeof(unknown));
+        memcpy(unknown.device.rom, rom, ROM_SIZE);
+        unknown.line = search_pin;
+        owi_get_resolution_all(&unknown.device.resolution);
+        sample = &unknown;
+    }
+    status = owi_read_temperature(&search_line, &sample->device);
+    if (status != RET_SUCCESS) {
+        serial_warning(SERIAL_SRC_OWI,
+                       "Alarming sensor on line %hu could not be read. Exit "
+                       "code: %d",
+                       search_pin, status);
+        return;
+    }
+    sample->device.available = true;
+    sample->timestamp_ms = timer_now_ms();
+    temperature_publish(sample);
+}
+
+/**
+ * @brief Latest deadline of the groups that are still converting.
+ */
+static uint32_t temperature_last_deadline() {
+    uint32_t deadline = timer_now_ms();
+    for (uint8_t group = 0; group < OWI_N_RESOLUTIONS; group++) {
+        if ((pending_groups & (1 << group)) &&
+            (int32_t)(group_deadlines[group] - deadline) > 0) {
+            deadline = group_deadlines[group];
+        }
+    }
+    return deadline;
+}
+
+/**
+ * @brief Converts the group that has just been read again if the sampling
+ * period has passed and the conversion is done before the slower groups.
+ */
+static void temperature_repeat_group() {
+    owi_bus_t line;
+    uint16_t conversion_ms = owi_conversion_time_ms(read_group);
+    uint32_t started_ms = group_deadlines[read_group] - conversion_ms;
+    uint32_t deadline = timer_deadline_ms(conversion_ms);
+
+    if (!sampling_period_ms || alarm_mode || !pending_groups ||
+        timer_elapsed_ms(started_ms) < sampling_period_ms ||
+        (int32_t)(temperature_last_deadline() - deadline) < 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < n_cached; i++) {
+        if (cycle_resolutions[i] != read_group) {
+            continue;
+        }
+        owi_line(bus, cache[i].line, &line);
+        if (owi_start_conversion_device(&line, &cache[i].device) !=
+            RET_SUCCESS) {
+            // read anyway to find out whether the sensor is gone
+            serial_debug(SERIAL_SRC_OWI, "Sensor %hu did not convert.", i);
+        }
+    }
+    pending_groups |= (1 << read_group);
+    repeated_groups |= (1 << read_group);
+    group_deadlines[read_group] = deadline;
+}
+
+/**
+ * @brief Starts reading the fastest group whose conversion is done.
+ */
+static void temperature_next_group(task_t *task) {
+    uint8_t group = OWI_N_RESOLUTIONS;
+    uint8_t all_done;
+
+    if (!pending_groups) {
+        temperature_finish(RET_SUCCESS);
+        return;
+    }
+    // the resolutions count down from 12 bit, so the fastest group is last
+    while (!(pending_groups & (1 << --group)))
+        ;
+    // the broadcast conversion may be done before the worst case time
+    all_done = !(repeated_groups & (1 << group)) &&
+               owi_conversion_done(bus) == RET_SUCCESS;
+    if (!all_done && !timer_expired(group_deadlines[group])) {
+        scheduler_sleep(task, CONVERSION_POLL_INTERVAL_MS);
+        return;
+    }
+    pending_groups &= ~(1 << group);
+    read_group = group;
+    read_round = 0;
+    state = TEMPERATURE_READING;
+}
+
+/**
+ * @brief Starts reading the next sensor of the current group on every line
+ * by addressing them directly.
+ */
+static void temperature_read_next() {
+    uint8_t n_line[OWI_MAX_LINES] = {0};
+    uint8_t any = false;
+
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        round_samples[line] = NULL;
+        round_devices[line] = NULL;
+    }
+    for (uint8_t i = 0; i < n_cached; i++) {
+        uint8_t line = cache[i].line;
+        if (cycle_resolutions[i] != read_group) {
+            continue;
+        }
+        if (n_line[line]++ == read_round) {
+            round_samples[line] = &cache[i];
+            round_devices[line] = &cache[i].device;
+            any = true;
+        }
+    }
+    if (!any) {
+        temperature_repeat_group();
+        state = TEMPERATURE_CONVERTING;
+        return;
+    }
+    read_round++;
+    owi_read_temperatures_start(bus, round_devices);
+    state = TEMPERATURE_COLLECTING;
+}
+
+/**
+ * @brief Stores the readings of the current round once the bus is done.
+ */
+static void temperature_collect(task_t *task) {
+    uint8_t failed;
+    uint32_t now_ms;
+
+    if (owi_read_temperatures_done(bus, round_devices, &failed) ==
+        RET_OWI_BUSY) {
+        scheduler_sleep(task, READ_POLL_INTERVAL_MS);
+        return;
+    }
+    state = TEMPERATURE_READING;
+    now_ms = timer_now_ms();
+    for (uint8_t line = 0; line < OWI_MAX_LINES; line++) {
+        if (round_samples[line] == NULL) {
+            continue;
+        }
+        if (failed & (1 << line)) {
+            serial_warning(SERIAL_SRC_OWI,
+                           "Sensor %hu on line %hu did not answer.",
+                           (uint8_t)(round_samples[line] - cache), line);
+            // the bus changed, search it again with the next cycle
+            table_valid = false;
+            continue;
+        }
+        round_samples[line]->device.available = true;
+        round_samples[line]->timestamp_ms = now_ms;
+        temperature_publish(round_samples[line]);
+    }
+}
+
+static void temperature_poll(task_t *task) {
+    return_status_t status;
+    switch (state) {
+        case TEMPERATURE_IDLE:
+            // only woken up here for background sampling
+            status = temperature_start();
+            if (status != RET_SUCCESS) {
+                temperature_finish(status);
+            }
+            break;
+        case TEMPERATURE_ENUMERATING:
+            temperature_enumerate_next();
+            break;
+        case TEMPERATURE_CONVERTING:
+            if (!alarm_mode) {
+                temperature_next_group(task);
+                break;
+            }
+            if (owi_conversion_done(bus) == RET_OWI_BUSY) {
+                scheduler_sleep(task, CONVERSION_POLL_INTERVAL_MS);
+                return;
+            }
+            temperature_search_reset();
+            state = TEMPERATURE_ALARM_SEARCHING;
+            break;
+        case TEMPERATURE_READING:
+            temperature_read_next();
+            break;
+        case TEMPERATURE_COLLECTING:
+            temperature_collect(task);
+            break;
+        case TEMPERATURE_ALARM_SEARCHING:
+            temperature_alarm_next();
+            break;
+    }
+}
+
+/**
+ * @brief Reports all cached readings that are not older than #max_age_ms.
+ *
+ * @return uint8_t Number of reported readings.
+ */
+static uint8_t temperature_report_cached(temperature_callback_t callback) {
+    uint8_t n_reported = 0;
+    for (uint8_t i = 0; i < n_cached; i++) {
+        if (cache[i].device.available &&
+            timer_elapsed_ms(cache[i].timestamp_ms) <= max_age_ms) {
+            callback(&cache[i]);
+            n_reported++;
+        }
+    }
+    return n_reported;
+}
+
+/**
+ * @brief Reports the readings taken since the running measurement started.
+ */
+static void temperature_report_cycle(temperature_callback_t callback) {
+    for (uint8_t i = 0; i < n_cached; i++) {
+        if (cache[i].device.available &&
+            (int32_t)(cache[i].timestamp_ms - cycle_start_ms) >= 0) {
+            callback(&cache[i]);
+        }
+    }
+}
+
+/**
+ * @brief Looks up the latest reading of the sensor with @p rom.
+ *
+ * @return const temperature_sample_t* `NULL` if the sensor is unknown or has
+ * not been read yet.
+ */
+const temperature_sample_t *temperature_latest(const uint8_t *rom) {
+    temperature_sample_t *sample = temperature_lookup(rom);
+    if (sample == NULL || !sample->device.available) {
+        return NULL;
+    }
+    return sample;
+}
+
+/**
+ * @brief Sets a function that is called with every new reading, no matter
+ * whether it was requested or sampled in the background. `NULL` removes it.
+ */
+void temperature_set_listener(temperature_callback_t listener) {
+    sample_listener = listener;
+}
+
+/**
+ * @brief Loads the device table persisted in EEPROM and registers the
+ * temperature task.
+ *
+ * The table is only used without a new search if every stored sensor still
+ * answers.
+ *
+ * @param owi_bus The initialized bus the sensors are connected to.
+ */
+void temperature_init(owi_bus_t *owi_bus) {
+    bus = owi_bus;
+    temperature_table_load();
+    table_valid = (n_cached > 0);
+    for (uint8_t i = 0; i < n_cached && table_valid; i++) {
+        owi_line(bus, cache[i].line, &search_line);
+        table_valid = owi_verify_rom(&search_line, cache[i].device.rom);
+        if (table_valid) {
+            temperature_load_profile(&cache[i]);
+        }
+    }
+    enumerated_ms = timer_now_ms();
+    serial_info(SERIAL_SRC_OWI, "%hu stored sensors %s.", n_cached,
+                table_valid ? "verified" : "need a new search");
+
+    scheduler_add(&temperature_task, temperature_poll);
+    scheduler_suspend(&temperature_task);
+}
+
+/**
+ * @brief Requests the temperature of all sensors on the bus and returns
+ * immediately.
+ *
+ * If a maximum age is set by @ref temperature_set_sampling() and fresh
+ * readings are cached, @p callback is called for each of them right away.
+ * Otherwise a measurement is started and @p callback is called from the
+ * temperature task for every sensor that has been read.
+ *
+ * A request while a measurement is already running, e.g. a background cycle,
+ * joins it. The sensors that have already been read in that cycle are
+ * reported right away from the cache, the remaining ones as they are read.
+ * A sensor whose group is converted again within the cycle may be reported
+ * twice.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_BUSY if an alarm measurement is running.
+ * - Return value of @ref owi_start_conversion()
+ */
+return_status_t temperature_measure(temperature_callback_t callback) {
+    if (max_age_ms && callback != NULL &&
+        temperature_report_cached(callback)) {
+        return RET_SUCCESS;
+    }
+    // an alarm measurement does not read all sensors
+    if (alarm_mode) {
+        return RET_OWI_BUSY;
+    }
+    measure_callback = callback;
+    if (state != TEMPERATURE_IDLE) {
+        if (callback != NULL) {
+            temperature_report_cycle(callback);
+        }
+        return RET_SUCCESS;
+    }
+    return temperature_start();
+}
+
+/**
+ * @brief Configures background sampling.
+ *
+ * @param period_ms Time between the start of two measurements. 0 stops
+ * background sampling after the current measurement.
+ * @param max_age Readings up to this age are reported from the cache by
+ * @ref temperature_measure(). 0 always measures.
+ */
+void temperature_set_sampling(uint32_t period_ms, uint32_t max_age) {
+    sampling_period_ms = period_ms;
+    max_age_ms = max_age;
+    serial_info(SERIAL_SRC_OWI, "Sampling period %lu ms, maximum age %lu ms",
+                period_ms, max_age);
+    if (sampling_period_ms && state == TEMPERATURE_IDLE) {
+        scheduler_wake(&temperature_task);
+    }
+}
+
+/**
+ * @brief Selects how the scratchpads are read, see @ref owi_read_mode_e.
+ *
+ * Takes effect with the next sensor that is read.
+ */
+void temperature_set_read_mode(owi_read_mode_t mode) {
+    owi_set_read_mode(bus, mode);
+    owi_set_read_mode(&search_line, mode);
+    serial_info(SERIAL_SRC_OWI, "Read mode %s",
+                mode == OWI_READ_FAST ? "fast" : "verified");
+}
+
+owi_read_mode_t temperature_get_read_mode() { return bus->read_mode; }
+
+/**
+ * @brief Copies the read counters of all lines.
+ */
+void temperature_get_stats(owi_stats_t *stats) { owi_get_stats(bus, stats); }
+
+/**
+ * @brief Starts a measurement that only reads the sensors outside of their
+ * alarm band and returns immediately.
+ *
+ * All sensors convert, but only those whose alarm flag is set afterwards are
+ * found by an ALARM SEARCH. @p callback is called from the temperature task
+ * for each of them and @p done once the search is complete.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_BUSY if a measurement is already running.
+ * - Return value of @ref owi_start_conversion()
+ */
+return_status_t temperature_measure_alarms(temperature_callback_t callback,
+                                           temperature_alarms_callback_t done) {
+    return_status_t status;
+    if (state != TEMPERATURE_IDLE) {
+        return RET_OWI_BUSY;
+    }
+    measure_callback = callback;
+    alarms_callback = done;
+    alarm_mode = true;
+    // the alarm search does not need the device table
+    cycle_start_ms = timer_now_ms();
+    status = temperature_convert();
+    if (status != RET_SUCCESS) {
+        alarms_callback = NULL;
+        temperature_finish(status);
+    }
+    return status;
+}
+
+/**
+ * @brief Sets the alarm band of the sensor with the ROM address @p rom.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_OWI_UNKNOWN_DEVICE if the sensor is not in the device table.
+ * - Return value of @ref owi_set_alarm()
+ */
+return_status_t temperature_set_alarm(const uint8_t *rom, int8_t high,
+                                      int8_t low) {
+    owi_bus_t line;
+    temperature_sample_t *sample = temperature_lookup(rom);
+    if (sample == NULL) {
+        return RET_OWI_UNKNOWN_DEVICE;
+    }
+    owi_line(bus, sample->line, &line);
+    return owi_set_alarm(&line, &sample->device, high, low);
+}
+
+/**
+ * @brief Sets the resolution profile of the sensor with the ROM address @p
+ * rom.
+ *
+ * The resolution is stored in the EEPROM of the sensor, whether it is
+ * adaptive in the device table.
+ *
+ * @param adaptive Drop to 9 bit while the reading is stable.
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_OWI_UNKNOWN_DEVICE if the sensor is not in the device table.
+ * - Return value of @ref owi_set_resolution()
+ */
+return_status_t temperature_set_profile(const uint8_t *rom,
+                                        owi_resolution_t resolution,
+                                        uint8_t adaptive) {
+    return_status_t status;
+    owi_bus_t line;
+    temperature_sample_t *sample = temperature_lookup(rom);
+    if (sample == NULL) {
+        return RET_OWI_UNKNOWN_DEVICE;
+    }
+    owi_line(bus, sample->line, &line);
+    status = owi_set_resolution(&line, &sample->device, resolution);
+    ASSERT_SUCCESS(status);
+    sample->resolution = resolution;
+    sample->adaptive = (adaptive != false);
+    sample->n_stable = 0;
+    temperature_table_store();
+    return RET_SUCCESS;
+}
+
+/**
+ * @brief Sets the resolution of all sensors on all lines of the bus.
+ *
+ * The broadcast overwrites the alarm bands, so the bands of the known sensors
+ * are read before and written back afterwards. This also stores the new
+ * resolution as their profile.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - Return value of @ref owi_set_resolution_all()
+ */
+return_status_t temperature_set_resolution(owi_resolution_t resolution) {
+    return_status_t status;
+    owi_bus_t line;
+    ds18b20_t *device;
+
+    for (uint8_t i = 0; i < n_cached; i++) {
+        device = &cache[i].device;
+        owi_line(bus, cache[i].line, &line);
+        if (owi_read_config(&line, device) != RET_SUCCESS) {
+            device->alarm_high_register = (uint8_t)OWI_ALARM_HIGH_OFF;
+            device->alarm_low_register = (uint8_t)OWI_ALARM_LOW_OFF;
+        }
+    }
+    status = owi_set_resolution_all(bus, resolution);
+    ASSERT_SUCCESS(status);
+    for (uint8_t i = 0; i < n_cached; i++) {
+        device = &cache[i].device;
+        cache[i].resolution = resolution;
+        cache[i].n_stable = 0;
+        owi_line(bus, cache[i].line, &line);
+        status = owi_set_alarm(&line, device,
+                               (int8_t)device->alarm_high_register,
+                               (int8_t)device->alarm_low_register);
+        if (status != RET_SUCCESS) {
+            serial_warning(SERIAL_SRC_OWI,
+                           "Profile of sensor %hu was not stored. Exit code: "
+                           "%d",
+                           i, status);
+        }
+    }
+    return RET_SUCCESS;
+}
+
+uint8_t temperature_busy() { return state != TEMPERATURE_IDLE; }
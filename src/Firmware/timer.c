@@ -0,0 +1,96 @@
+/**
+ * @file timer.c
+ * @brief Monotonic system timebase driven by Timer0.
+ *
+ * Timer0 runs in CTC mode with a prescaler of 64, so each counter step is
+ * 4 us at 16 MHz and the compare match fires once per millisecond. All
+ * timestamps are free running and wrap around, so compare them only through
+ * the helpers in this file.
+ */
+#include "timer.h"
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#define TIMER_PRESCALER 64
+#define TIMER_TICKS_PER_MS (F_CPU / TIMER_PRESCALER / 1000UL)
+#define TIMER_US_PER_TICK (1000UL / TIMER_TICKS_PER_MS)
+
+#if TIMER_TICKS_PER_MS > 256
+#error "Timer0 cannot generate a 1 ms tick at this F_CPU"
+#endif
+
+static volatile uint32_t milliseconds = 0;
+
+void timer_init() {
+    TCCR0A = (1 << WGM01);
+    TCCR0B = (1 << CS01) | (1 << CS00);
+    OCR0A = TIMER_TICKS_PER_MS - 1;
+    TCNT0 = 0;
+    TIMSK0 |= (1 << OCIE0A);
+}
+
+/**
+ * @brief Milliseconds since @ref timer_init().
+ */
+uint32_t timer_now_ms() {
+    uint32_t now;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { now = milliseconds; }
+    return now;
+}
+
+/**
+ * @brief Microseconds since @ref timer_init() with a resolution of one timer
+ * tick.
+ *
+ * Wraps around after roughly 71 minutes.
+ */
+uint32_t timer_now_us() {
+    uint32_t ms;
+    uint8_t ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        ms = milliseconds;
+        ticks = TCNT0;
+        // compare match happened but the ISR did not run yet
+        if ((TIFR0 & (1 << OCF0A)) && ticks < TIMER_TICKS_PER_MS - 1) {
+            ms++;
+        }
+    }
+    return ms * 1000UL + (uint32_t)ticks * TIMER_US_PER_TICK;
+}
+
+/**
+ * @brief Computes the point in time @p timeout_ms from now.
+ *
+ * @par Example
+ * @code{.c}
+ * uint32_t deadline = timer_deadline_ms(100);
+ * while (!timer_expired(deadline)) {
+ *     do_other_work();
+ * }
+ * @endcode
+ */
+uint32_t timer_deadline_ms(uint32_t timeout_ms) {
+    return timer_now_ms() + timeout_ms;
+}
+
+/**
+ * @brief Checks whether @p deadline_ms has been reached.
+ *
+ * Works across wrap arounds as long as the deadline is less than ~24 days in
+ * the future.
+ */
+uint8_t timer_expired(uint32_t deadline_ms) {
+    return (int32_t)(timer_now_ms() - deadline_ms) >= 0;
+}
+
+uint32_t timer_elapsed_ms(uint32_t since_ms) {
+    return timer_now_ms() - since_ms;
+}
+
+uint32_t timer_elapsed_us(uint32_t since_us) {
+    return timer_now_us() - since_us;
+}
+
+ISR(TIMER0_COMPA_vect) { milliseconds++; }
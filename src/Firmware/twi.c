@@ -1,117 +1,471 @@
+/**
+ * @file twi.c
+ * @brief Interrupt driven I2C master with a transaction queue.
+ *
+ * Drivers describe a complete transfer in a @ref twi_transaction_t and submit
+ * it. The transactions are run one after the other by the TWI interrupt, so
+ * the CPU only spends a few cycles per byte on the bus. Completion callbacks
+ * and timeouts are handled by the TWI task in the main loop.
+ *
+ * A transaction that exceeds its deadline, e.g. because a slave stretches the
+ * clock forever or holds SDA low, is aborted. The bus is then recovered by
+ * clocking SCL manually until the slave releases SDA and generating a STOP
+ * condition, before the next transaction is started.
+ *
+ * Each slave can be registered with the highest clock it supports. The bit
+ * rate is switched before each transaction, so slow devices do not slow down
+ * transfers with fast ones.
+ */
 #include "twi.h"
 
+#include <avr/interrupt.h>
 #include <avr/io.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <util/atomic.h>
+#include <util/delay.h>
 #include <util/twi.h>
 
+#include "scheduler.h"
 #include "serial.h"
+#include "timer.h"
 
-return_status_t twi_sla_w(uint8_t slave_address);
-return_status_t twi_sla_r(uint8_t slave_address);
-return_status_t twi_read_ack(uint8_t *data);
-return_status_t twi_read_nack(uint8_t *data);
+// a STOP takes half a clock period, this covers it down to 10 kHz
+#define STOP_WAIT_LOOPS 255
 
-void twi_init() { TWBR = 72; }
+#define TWI_PORT PORTD
+#define TWI_SCL PD0
+#define TWI_SDA PD1
+#define TWI_DDR DDR_REGISTER(TWI_PORT)
+#define TWI_PIN PIN_REGISTER(TWI_PORT)
+// half a clock period at 100 kHz
+#define RECOVERY_DELAY_US 5
+#define RECOVERY_CLOCKS 9
 
-return_status_t twi_start_write(uint8_t slave_address) {
-    serial_debug(SERIAL_SRC_TWI, "Start transmitting");
-    uint8_t status;
-    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-    loop_until_bit_is_set(TWCR, TWINT);
+#define TWCR_ENABLE ((1 << TWEN) | (1 << TWIE) | (1 << TWINT))
 
-    status = TW_STATUS;
+typedef struct {
+    uint8_t address;
+    uint8_t bitrate;
+    uint8_t prescaler;
+} twi_device_t;
 
-    if (!(status == TW_START || status == TW_REP_START)) {
-        return RET_TWI_START_ERR;
-    }
+static task_t twi_task;
+static uint8_t initialized = false;
 
-    status = twi_sla_w(slave_address);
-    if (status != RET_SUCCESS) {
-        serial_debug(
-            SERIAL_SRC_TWI,
-            "Could not start master transmitter. Error code: %d TWSTATUS: %02x",
-            status, TW_STATUS);
-    }
+static twi_device_t devices[TWI_MAX_DEVICES];
+static uint8_t n_devices = 0;
+static uint8_t default_bitrate;
+static uint8_t default_prescaler;
 
-    ASSERT_SUCCESS(status);
+/**
+ * @brief Queued transactions. The first one is on the bus.
+ */
+static twi_transaction_t *volatile queue_head = NULL;
+static twi_transaction_t *volatile queue_tail = NULL;
+/**
+ * @brief Finished transactions whose callback has not been called yet.
+ */
+static twi_transaction_t *volatile done_head = NULL;
+static twi_transaction_t *volatile done_tail = NULL;
+/**
+ * @brief Number of bytes of the active transaction that have been written or
+ * read.
+ */
+static volatile uint8_t byte_index;
+static volatile uint8_t reading;
+/**
+ * @brief Set if the bus has to be recovered before the next transaction.
+ */
+static volatile uint8_t recovery_pending = false;
 
-    return RET_SUCCESS;
+/**
+ * @brief Computes the TWBR and prescaler values for the fastest SCL frequency
+ * not above @p clock_hz.
+ *
+ * SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+ */
+static void twi_clock_settings(uint32_t clock_hz, uint8_t *bitrate,
+                               uint8_t *prescaler) {
+    uint32_t divider;
+    if (clock_hz > TWI_MAX_CLOCK_HZ) {
+        clock_hz = TWI_MAX_CLOCK_HZ;
+    }
+    divider = (F_CPU + clock_hz - 1) / clock_hz;
+    divider = divider > 16 ? (divider - 16 + 1) / 2 : 0;
+    for (*prescaler = 0; *prescaler < 3 && divider > 0xFF; (*prescaler)++) {
+        divider = (divider + 3) / 4;
+    }
+    *bitrate = divider > 0xFF ? 0xFF : divider;
 }
 
-return_status_t twi_start_read(uint8_t slave_address) {
-    serial_debug(SERIAL_SRC_TWI, "Start receiving");
-    uint8_t status;
-    TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-    loop_until_bit_is_set(TWCR, TWINT);
+/**
+ * @brief Sets the bit rate registered for @p address.
+ */
+static void twi_select_clock(uint8_t address) {
+    uint8_t bitrate = default_bitrate;
+    uint8_t prescaler = default_prescaler;
+    for (uint8_t i = 0; i < n_devices; i++) {
+        if (devices[i].address == address) {
+            bitrate = devices[i].bitrate;
+            prescaler = devices[i].prescaler;
+            break;
+        }
+    }
+    TWBR = bitrate;
+    TWSR = prescaler;
+}
+
+/**
+ * @brief Generates a START condition for the first queued transaction.
+ *
+ * Has to be called with interrupts disabled.
+ */
+static void twi_start_next(uint8_t after_stop) {
+    twi_transaction_t *transaction = queue_head;
+    uint16_t timeout_ms;
+    uint8_t loops = STOP_WAIT_LOOPS;
+    if (after_stop) {
+        TWCR = TWCR_ENABLE | (1 << TWSTO);
+    }
+    if (transaction == NULL || recovery_pending) {
+        return;
+    }
+    // the STOP has to be on the bus before the clock may change
+    while (after_stop && (TWCR & (1 << TWSTO)) && --loops)
+        ;
+    twi_select_clock(transaction->address);
+    timeout_ms = transaction->timeout_ms ? transaction->timeout_ms
+                                         : TWI_DEFAULT_TIMEOUT_MS;
+    transaction->deadline = timer_deadline_ms(timeout_ms);
+    byte_index = 0;
+    reading = (transaction->write_length == 0 && transaction->read_length);
+    TWCR = TWCR_ENABLE | (1 << TWSTA);
+}
 
-    status = TW_STATUS;
+/**
+ * @brief Removes the active transaction from the queue with the result
+ * @p status.
+ *
+ * Has to be called with interrupts disabled.
+ */
+static void twi_complete(return_status_t status) {
+    twi_transaction_t *transaction = queue_head;
+    if (transaction == NULL) {
+        return;
+    }
+    queue_head = transaction->next;
+    if (queue_head == NULL) {
+        queue_tail = NULL;
+    }
+    transaction->next = NULL;
+    if (transaction->callback != NULL) {
+        if (done_tail != NULL) {
+            done_tail->next = transaction;
+        } else {
+            done_head = transaction;
+        }
+        done_tail = transaction;
+    }
+    transaction->status = status;
+}
 
-    if (!(status == TW_START || status == TW_REP_START))
-        return RET_TWI_START_ERR;
+/**
+ * @brief Frees a bus that is held by a slave.
+ *
+ * A slave that missed clock pulses may hold SDA low while it waits for the
+ * rest of a byte. SCL is pulsed until SDA is released, then a STOP condition
+ * resets the state machines of all slaves. Only the DDR bits of the pins are
+ * changed, so the external pull-ups drive the released lines.
+ */
+static void twi_recover() {
+    TWCR = 0;
+    TWI_PORT &= ~((1 << TWI_SCL) | (1 << TWI_SDA));
+    for (uint8_t i = 0; i < RECOVERY_CLOCKS && !(TWI_PIN & (1 << TWI_SDA));
+         i++) {
+        TWI_DDR |= (1 << TWI_SCL);
+        _delay_us(RECOVERY_DELAY_US);
+        TWI_DDR &= ~(1 << TWI_SCL);
+        _delay_us(RECOVERY_DELAY_US);
+    }
+    // STOP: SDA rises while SCL is high
+    TWI_DDR |= (1 << TWI_SDA);
+    _delay_us(RECOVERY_DELAY_US);
+    TWI_DDR &= ~(1 << TWI_SDA);
+    _delay_us(RECOVERY_DELAY_US);
+    TWCR = (1 << TWEN);
+    serial_warning(SERIAL_SRC_TWI, "Bus recovered, SDA %s",
+                   (TWI_PIN & (1 << TWI_SDA)) ? "released" : "still low");
+}
 
-    status = twi_sla_r(slave_address);
+/**
+ * @brief Aborts a transaction that exceeded its deadline, recovers the bus
+ * if needed and calls the callbacks of finished transactions.
+ */
+static void twi_service() {
+    twi_transaction_t *transaction;
+    twi_transaction_t *timed_out = NULL;
+    uint8_t recover;
 
-    if (status != RET_SUCCESS) {
-        serial_debug(
-            SERIAL_SRC_TWI,
-            "Could not start master receiver. Error code: %d TWSTATUS: %02x",
-            status, TW_STATUS);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue_head != NULL && !recovery_pending &&
+            timer_expired(queue_head->deadline)) {
+            timed_out = queue_head;
+            twi_complete(RET_TWI_TIMEOUT);
+            recovery_pending = true;
+        }
+        recover = recovery_pending;
+    }
+    if (timed_out != NULL) {
+        serial_warning(SERIAL_SRC_TWI,
+                       "Transaction with 0x%02x timed out. TWSTATUS: %02x",
+                       timed_out->address, TW_STATUS);
+    }
+    if (recover) {
+        twi_recover();
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            recovery_pending = false;
+            twi_start_next(false);
+        }
     }
 
-    ASSERT_SUCCESS(status);
+    while (1) {
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            transaction = done_head;
+            if (transaction != NULL) {
+                done_head = transaction->next;
+                if (done_head == NULL) {
+                    done_tail = NULL;
+                }
+                transaction->next = NULL;
+            }
+        }
+        if (transaction == NULL) {
+            break;
+        }
+        transaction->callback(transaction);
+    }
+}
 
-    return RET_SUCCESS;
+static void twi_poll(task_t *task) {
+    twi_service();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue_head == NULL && done_head == NULL) {
+            scheduler_suspend(task);
+        }
+    }
 }
 
-return_status_t twi_write(uint8_t *data, uint8_t length) {
-    return_status_t status;
-    for (uint8_t i = 0; i < length; i++) {
-        status = twi_write_byte(data[i]);
-        if (status != RET_SUCCESS) return status;
+/**
+ * @brief Initializes the TWI peripheral as master and registers the TWI task.
+ *
+ * Can be called by every driver that uses the bus, only the first call has an
+ * effect.
+ */
+void twi_init() {
+    if (initialized) {
+        return;
     }
-    return RET_SUCCESS;
+    initialized = true;
+    twi_clock_settings(TWI_DEFAULT_CLOCK_HZ, &default_bitrate,
+                       &default_prescaler);
+    TWBR = default_bitrate;
+    TWSR = default_prescaler;
+    TWCR = (1 << TWEN);
+    scheduler_add(&twi_task, twi_poll);
+    scheduler_suspend(&twi_task);
 }
 
-return_status_t twi_read(uint8_t *data, uint8_t length) {
-    for (uint8_t i = 0; i < length - 1; i++) {
-        twi_read_ack(data + i);
+/**
+ * @brief Registers the highest SCL frequency the slave at @p address
+ * supports.
+ *
+ * Transactions with the slave are clocked with @p max_clock_hz, but not
+ * faster than #TWI_MAX_CLOCK_HZ. Registering a slave again updates its
+ * clock.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_TWI_TOO_MANY_DEVICES if #TWI_MAX_DEVICES slaves are registered.
+ */
+return_status_t twi_register_device(uint8_t address, uint32_t max_clock_hz) {
+    uint8_t i;
+    for (i = 0; i < n_devices; i++) {
+        if (devices[i].address == address) {
+            break;
+        }
+    }
+    if (i >= TWI_MAX_DEVICES) {
+        return RET_TWI_TOO_MANY_DEVICES;
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        devices[i].address = address;
+        twi_clock_settings(max_clock_hz, &devices[i].bitrate,
+                           &devices[i].prescaler);
+        if (i == n_devices) {
+            n_devices++;
+        }
     }
-    twi_read_nack(data + length - 1);
     return RET_SUCCESS;
 }
 
-void twi_stop() { TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN); }
+/**
+ * @brief Fills in a transaction without a callback and with the default
+ * timeout.
+ */
+void twi_transaction_init(twi_transaction_t *transaction, uint8_t address,
+                          const uint8_t *write_data, uint8_t write_length,
+                          uint8_t *read_data, uint8_t read_length) {
+    transaction->address = address;
+    transaction->write_data = write_data;
+    transaction->write_length = write_length;
+    transaction->read_data = read_data;
+    transaction->read_length = read_length;
+    transaction->timeout_ms = 0;
+    transaction->callback = NULL;
+    transaction->context = NULL;
+    transaction->status = RET_SUCCESS;
+    transaction->next = NULL;
+}
 
-return_status_t twi_write_byte(uint8_t data) {
-    TWDR = data;
-    TWCR = (1 << TWINT) | (1 << TWEN);
-    loop_until_bit_is_set(TWCR, TWINT);
-    if (!((TW_STATUS == TW_MT_DATA_ACK) || (TW_STATUS == TW_MT_SLA_ACK) ||
-          (TW_STATUS == TW_MR_SLA_ACK))) {
-        return RET_TWI_NO_ACK;
+/**
+ * @brief Appends @p transaction to the queue and returns immediately.
+ *
+ * The result is stored in @ref twi_transaction_s.status once the transaction
+ * is done and the callback is called afterwards from the TWI task. A
+ * transaction with a callback must not be submitted again before its
+ * callback has been called.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_TWI_BUSY if @p transaction is still queued.
+ */
+return_status_t twi_submit(twi_transaction_t *transaction) {
+    if (transaction->status == RET_TWI_BUSY) {
+        return RET_TWI_BUSY;
     }
+    transaction->status = RET_TWI_BUSY;
+    transaction->next = NULL;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        if (queue_tail != NULL) {
+            queue_tail->next = transaction;
+            queue_tail = transaction;
+        } else {
+            queue_head = transaction;
+            queue_tail = transaction;
+            twi_start_next(false);
+        }
+    }
+    scheduler_resume(&twi_task);
     return RET_SUCCESS;
 }
 
-return_status_t twi_sla_w(uint8_t slave_address) {
-    uint8_t byte = (uint8_t)(slave_address << 1) | TW_WRITE;
-    return twi_write_byte(byte);
+/**
+ * @brief Waits until @p transaction is done.
+ *
+ * Blocks the caller, but keeps the queue going, so it can also be used
+ * before the scheduler runs.
+ *
+ * @return Returns the status of the transaction.
+ */
+return_status_t twi_wait(twi_transaction_t *transaction) {
+    while (transaction->status == RET_TWI_BUSY) {
+        twi_service();
+    }
+    return transaction->status;
 }
 
-return_status_t twi_sla_r(uint8_t slave_address) {
-    uint8_t byte = (uint8_t)(slave_address << 1) | TW_READ;
-    return twi_write_byte(byte);
+/**
+ * @brief Submits @p transaction and waits until it is done.
+ *
+ * @return Returns one of the following exit codes defined in @ref
+ * return_status_t.
+ * - @ref RET_SUCCESS
+ * - @ref RET_TWI_NO_ACK if the slave did not acknowledge its address or a
+ * byte.
+ * - @ref RET_TWI_TIMEOUT
+ * - @ref RET_TWI_BUS_ERR
+ * - Return value of @ref twi_submit()
+ */
+return_status_t twi_transfer(twi_transaction_t *transaction) {
+    return_status_t status;
+    status = twi_submit(transaction);
+    ASSERT_SUCCESS(status);
+    return twi_wait(transaction);
 }
 
-return_status_t twi_read_ack(uint8_t *data) {
-    TWCR = (1 << TWINT) | (1 << TWEA) | (1 << TWEN);
-    loop_until_bit_is_set(TWCR, TWINT);
-    *data = TWDR;
-    return RET_SUCCESS;
+/**
+ * @brief Checks whether transactions are queued.
+ */
+uint8_t twi_busy() {
+    uint8_t busy;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { busy = (queue_head != NULL); }
+    return busy;
 }
 
-return_status_t twi_read_nack(uint8_t *data) {
-    TWCR = (1 << TWINT) | (1 << TWEN);
-    loop_until_bit_is_set(TWCR, TWINT);
-    *data = TWDR;
-    return RET_SUCCESS;
+ISR(TWI_vect) {
+    twi_transaction_t *transaction = queue_head;
+    uint8_t status = TW_STATUS;
+
+    if (transaction == NULL) {
+        TWCR = TWCR_ENABLE | (1 << TWSTO);
+        return;
+    }
+    switch (status) {
+        case TW_START:
+        case TW_REP_START:
+            TWDR = (uint8_t)(transaction->address << 1) |
+                   (reading ? TW_READ : TW_WRITE);
+            TWCR = TWCR_ENABLE;
+            break;
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (byte_index < transaction->write_length) {
+                TWDR = transaction->write_data[byte_index++];
+                TWCR = TWCR_ENABLE;
+            } else if (transaction->read_length) {
+                byte_index = 0;
+                reading = true;
+                TWCR = TWCR_ENABLE | (1 << TWSTA);
+            } else {
+                twi_complete(RET_SUCCESS);
+                twi_start_next(true);
+            }
+            break;
+        case TW_MR_SLA_ACK:
+            // acknowledge every byte but the last one
+            TWCR = TWCR_ENABLE |
+                   (transaction->read_length > 1 ? (1 << TWEA) : 0);
+            break;
+        case TW_MR_DATA_ACK:
+            transaction->read_data[byte_index++] = TWDR;
+            TWCR = TWCR_ENABLE |
+                   (byte_index + 1 < transaction->read_length ? (1 << TWEA)
+                                                              : 0);
+            break;
+        case TW_MR_DATA_NACK:
+            transaction->read_data[byte_index++] = TWDR;
+            twi_complete(RET_SUCCESS);
+            twi_start_next(true);
+            break;
+        case TW_MT_SLA_NACK:
+        case TW_MR_SLA_NACK:
+        case TW_MT_DATA_NACK:
+            twi_complete(RET_TWI_NO_ACK);
+            twi_start_next(true);
+            break;
+        case TW_BUS_ERROR:
+            // the hardware releases the lines on a STOP without sending it
+            twi_complete(RET_TWI_BUS_ERR);
+            twi_start_next(true);
+            break;
+        default:
+            // lost arbitration on a single master bus means a glitch
+            TWCR = (1 << TWEN);
+            twi_complete(RET_TWI_BUS_ERR);
+            recovery_pending = true;
+            break;
+    }
 }
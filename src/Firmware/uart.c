@@ -3,13 +3,24 @@
 #include <avr/io.h>
 #include <stdbool.h>
 #include <stdlib.h>
-#include <util/delay.h>
+
+#include "timer.h"
 
 static void (*uart_0_receive_callback)(char) = NULL;
 static void (*uart_1_receive_callback)(char) = NULL;
 static void (*uart_2_receive_callback)(char) = NULL;
 static void (*uart_3_receive_callback)(char) = NULL;
 
+#if UART_0_TX_BUFFER_SIZE != 256
+#error "UART_0_TX_BUFFER_SIZE has to be 256"
+#endif
+
+// producer (main context) only writes head, the UDRE ISR only writes tail.
+// one slot is kept empty to tell a full buffer from an empty one.
+static volatile uint8_t uart_0_tx_buffer[UART_0_TX_BUFFER_SIZE];
+static volatile uint8_t uart_0_tx_head = 0;
+static volatile uint8_t uart_0_tx_tail = 0;
+
 uint8_t uart_init(uint8_t uart_id, uint32_t baud) {
     // 1. set baud rate
     // 2. enable transmitter and receiver
@@ -17,6 +28,8 @@ uint8_t uart_init(uint8_t uart_id, uint32_t baud) {
     uint16_t baud_register = F_CPU / (16 * baud) - 1;
     switch (uart_id) {
         case 0:
+            uart_0_tx_head = 0;
+            uart_0_tx_tail = 0;
             UBRR0 = baud_register;
             UCSR0B = (1 << RXEN0) | (1 << TXEN0);
             UCSR0C = (1 << UCSZ01) | (1 << UCSZ00);
@@ -67,10 +80,79 @@ void uart_3_set_receive_callback(void (*receive_callback)(char)) {
     uart_3_receive_callback = receive_callback;
 }
 
+/**
+ * @brief Pushes the oldest queued byte out by polling if the UDRE ISR cannot
+ * do so because interrupts are globally disabled.
+ */
+static void uart_0_tx_poll() {
+    if (!(SREG & (1 << SREG_I)) && (UCSR0A & (1 << UDRE0)) &&
+        (uart_0_tx_head != uart_0_tx_tail)) {
+        uint8_t tail = uart_0_tx_tail;
+        UDR0 = uart_0_tx_buffer[tail++];
+        uart_0_tx_tail = tail;
+    }
+}
+
+/**
+ * @brief Number of bytes that can be queued without blocking.
+ */
+uint8_t uart_0_tx_free() {
+    return (uint8_t)(uart_0_tx_tail - uart_0_tx_head - 1);
+}
+
+/**
+ * @brief Queues as many bytes of @p data as currently fit into the transmit
+ * buffer and returns immediately.
+ *
+ * @return uint8_t Number of bytes actually queued.
+ */
+uint8_t uart_0_try_write(const uint8_t *data, uint8_t length) {
+    uint8_t free = uart_0_tx_free();
+    uint8_t head = uart_0_tx_head;
+    if (length > free) {
+        length = free;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+        uart_0_tx_buffer[head++] = data[i];
+    }
+    uart_0_tx_head = head;
+    if (length) {
+        UCSR0B |= (1 << UDRIE0);
+    }
+    return length;
+}
+
+/**
+ * @brief Queues all @p length bytes of @p data, blocking only while the
+ * transmit buffer is full.
+ *
+ * Unlike @ref uart_0_puts() this does not stop at 0 bytes or after 255
+ * characters.
+ */
+void uart_0_write(const uint8_t *data, uint8_t length) {
+    uint8_t written;
+    while (length) {
+        while (uart_0_tx_free() == 0) {
+            uart_0_tx_poll();
+        }
+        written = uart_0_try_write(data, length);
+        data += written;
+        length -= written;
+    }
+}
+
+/**
+ * @brief Blocks until every queued byte has been handed to the USART.
+ */
+void uart_0_flush() {
+    while (uart_0_tx_head != uart_0_tx_tail) {
+        uart_0_tx_poll();
+    }
+}
+
 void uart_0_putc(char c) {
-    while (!(UCSR0A & (1 << UDRE0)))
-        ;
-    UDR0 = c;
+    uint8_t byte = (uint8_t)c;
+    uart_0_write(&byte, 1);
 }
 
 void uart_1_putc(char c) {
@@ -120,49 +202,49 @@ char uart_3_getc() {
 }
 
 char uart_0_getc_timeout(uint16_t timeout, uint8_t *success) {
-    for (uint16_t i = 0; i < timeout; i++) {
+    uint32_t deadline = timer_deadline_ms(timeout);
+    do {
         if (UCSR0A & (1 << RXC0)) {
             *success = true;
             return UDR0;
         }
-        _delay_ms(1);
-    }
+    } while (!timer_expired(deadline));
     *success = false;
     return 0;
 }
 
 char uart_1_getc_timeout(uint16_t timeout, uint8_t *success) {
-    for (uint16_t i = 0; i < timeout; i++) {
+    uint32_t deadline = timer_deadline_ms(timeout);
+    do {
         if (UCSR1A & (1 << RXC1)) {
             *success = true;
             return UDR1;
         }
-        _delay_ms(1);
-    }
+    } while (!timer_expired(deadline));
     *success = false;
     return 0;
 }
 
 char uart_2_getc_timeout(uint16_t timeout, uint8_t *success) {
-    for (uint16_t i = 0; i < timeout; i++) {
+    uint32_t deadline = timer_deadline_ms(timeout);
+    do {
         if (UCSR2A & (1 << RXC2)) {
             *success = true;
             return UDR2;
         }
-        _delay_ms(1);
-    }
+    } while (!timer_expired(deadline));
     *success = false;
     return 0;
 }
 
 char uart_3_getc_timeout(uint16_t timeout, uint8_t *success) {
-    for (uint16_t i = 0; i < timeout; i++) {
+    uint32_t deadline = timer_deadline_ms(timeout);
+    do {
         if (UCSR3A & (1 << RXC3)) {
             *success = true;
             return UDR3;
         }
-        _delay_ms(1);
-    }
+    } while (!timer_expired(deadline));
     *success = false;
     return 0;
 }
@@ -202,6 +284,17 @@ ISR(USART0_RX_vect) {
     }
 }
 
+ISR(USART0_UDRE_vect) {
+    uint8_t tail = uart_0_tx_tail;
+    if (tail != uart_0_tx_head) {
+        UDR0 = uart_0_tx_buffer[tail++];
+        uart_0_tx_tail = tail;
+    }
+    if (tail == uart_0_tx_head) {
+        UCSR0B &= ~(1 << UDRIE0);
+    }
+}
+
 ISR(USART1_RX_vect) {
     char data = UDR1;
     if (uart_1_receive_callback != NULL) {